@@ -8,41 +8,124 @@
 extern "C" void setup(void);
 extern "C" void loop(void);
 
-// Main function required by AVR
+// Writes out buffered Serial output and the VCD trace. Registered with
+// atexit() so a sketch that ends the run with exit() keeps what it printed
+// during its last iteration; after a normal run there is nothing left.
+static void finishRun(void) {
+    simSetContext(&simDefaultContext);
+    Serial.flush();
+    vcdEnd();
+}
+
+// Main function required by AVR. On the host the run ends when the
+// scheduler's time or loop budget is exhausted.
 int main(void) {
+    atexit(finishRun);
+    clockInit();
+    schedulerInit();
+    vcdInit();
+    adcInit();
     setup();
-
-    for (;;) {
-        loop();
-    }
+    schedulerRun();
+    serialEventRun();
+    vcdEnd();
+    simContextFree(&simDefaultContext);
 
     return 0;
 }
 
-// Digital I/O stubs
+// Digital I/O
+#define PIN_RULE_4(RULE, P) RULE(P), RULE(P + 1), RULE(P + 2), RULE(P + 3)
+#define PIN_RULE_20(RULE) \
+    PIN_RULE_4(RULE, 0), PIN_RULE_4(RULE, 4), PIN_RULE_4(RULE, 8), \
+    PIN_RULE_4(RULE, 12), PIN_RULE_4(RULE, 16)
+
+// Entries past NUM_DIGITAL_PINS stay zero: port PB with an empty mask
+const uint8_t digital_pin_to_port_PGM[256] PROGMEM = { PIN_RULE_20(PIN_TO_PORT_RULE) };
+const uint8_t digital_pin_to_bit_mask_PGM[256] PROGMEM = { PIN_RULE_20(PIN_TO_BIT_MASK_RULE) };
+const uint8_t digital_pin_to_timer_PGM[256] PROGMEM = { PIN_RULE_20(PIN_TO_TIMER_RULE) };
+
 void pinMode(uint8_t pin, uint8_t mode) {
-    // Stub implementation
-    (void)pin;
-    (void)mode;
+    simPinsSetMode(simContext()->pins, digitalPinToPort(pin), digitalPinToBitMask(pin), mode);
 }
 
 void digitalWrite(uint8_t pin, uint8_t val) {
-    // Stub implementation
-    (void)pin;
-    (void)val;
+    simPinsWrite(simContext()->pins, digitalPinToPort(pin), digitalPinToBitMask(pin), val);
 }
 
 int digitalRead(uint8_t pin) {
-    // Stub implementation
-    (void)pin;
-    return LOW;
+    return simPinsRead(simContext()->pins, digitalPinToPort(pin), digitalPinToBitMask(pin));
 }
 
-// Analog I/O stubs
+void digitalWritePort(uint8_t port, uint8_t mask, uint8_t value) {
+    if (port >= NUM_PORTS) {
+        return;
+    }
+    SimPins &pins = simContext()->pins;
+    pins.port[port] = (pins.port[port] & ~mask) | (value & mask);
+    simPinsRefresh(pins, port);
+    simPinsEndPwm(pins, port, mask);
+}
+
+uint8_t digitalReadPort(uint8_t port) {
+    if (port >= NUM_PORTS) {
+        return 0;
+    }
+    return simContext()->pins.pin[port];
+}
+
+void pinGroupInit(PinGroup *group, const uint8_t *pins, uint8_t count) {
+    if (count > PIN_GROUP_MAX_PINS) {
+        count = PIN_GROUP_MAX_PINS;
+    }
+    memset(group, 0, sizeof(*group));
+    group->count = count;
+    for (uint8_t i = 0; i < count; i++) {
+        group->port[i] = digitalPinToPort(pins[i]);
+        group->mask[i] = digitalPinToBitMask(pins[i]);
+        group->port_mask[group->port[i]] |= group->mask[i];
+    }
+}
+
+void pinGroupWrite(const PinGroup *group, uint32_t bits) {
+    uint8_t value[NUM_PORTS] = { 0 };
+    for (uint8_t i = 0; i < group->count; i++) {
+        value[group->port[i]] |= group->mask[i] & (uint8_t)-(uint8_t)((bits >> i) & 1);
+    }
+
+    SimPins &pins = simContext()->pins;
+    for (uint8_t port = 0; port < NUM_PORTS; port++) {
+        uint8_t mask = group->port_mask[port];
+        if (mask != 0) {
+            pins.port[port] = (pins.port[port] & ~mask) | value[port];
+            simPinsRefresh(pins, port);
+            simPinsEndPwm(pins, port, mask);
+        }
+    }
+}
+
+void pinDrive(uint8_t pin, uint8_t level) {
+    uint8_t port = digitalPinToPort(pin);
+    uint8_t mask = digitalPinToBitMask(pin);
+    SimPins &pins = simContext()->pins;
+
+    uint8_t bits = (uint8_t)-(uint8_t)(level != LOW);
+    pins.ext[port] = (pins.ext[port] & ~mask) | (bits & mask);
+    pins.driven[port] |= mask;
+    simPinsRefresh(pins, port);
+}
+
+void pinRelease(uint8_t pin) {
+    uint8_t port = digitalPinToPort(pin);
+    SimPins &pins = simContext()->pins;
+
+    pins.driven[port] &= ~digitalPinToBitMask(pin);
+    simPinsRefresh(pins, port);
+}
+
+// Analog I/O
 int analogRead(uint8_t pin) {
-    // Stub implementation
-    (void)pin;
-    return 0;
+    return adcRead(pin);
 }
 
 void analogReference(uint8_t mode) {
@@ -50,35 +133,32 @@ void analogReference(uint8_t mode) {
     (void)mode;
 }
 
+// PWM on pins with a timer output (SimPwm.h); 0, 255 and other pins are
+// plain digital writes
 void analogWrite(uint8_t pin, int val) {
-    // Stub implementation
-    (void)pin;
-    (void)val;
+    pinMode(pin, OUTPUT);
+    if (val <= 0 || val >= 255 || digitalPinToTimer(pin) == NOT_ON_TIMER) {
+        digitalWrite(pin, val < 128 ? LOW : HIGH);
+    } else {
+        pwmStart(pin, (uint8_t)val);
+    }
 }
 
-// Timing stubs
+// Timing
 unsigned long millis(void) {
-    // Stub implementation - would need timer setup
-    return 0;
+    return (unsigned long)(clockMicros64() / 1000);
 }
 
 unsigned long micros(void) {
-    // Stub implementation
-    return 0;
+    return (unsigned long)clockMicros64();
 }
 
 void delay(unsigned long ms) {
-    // Stub implementation - basic busy wait
-    for (unsigned long i = 0; i < ms * 1000; i++) {
-        __asm__ __volatile__("nop");
-    }
+    schedulerSleepUntil(clockMicros64() + (uint64_t)ms * 1000);
 }
 
 void delayMicroseconds(unsigned int us) {
-    // Stub implementation
-    for (unsigned int i = 0; i < us; i++) {
-        __asm__ __volatile__("nop");
-    }
+    schedulerSleepUntil(clockMicros64() + us);
 }
 
 // Pulse measurement stubs
@@ -115,39 +195,64 @@ uint8_t shiftIn(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder) {
     return 0;
 }
 
-// Interrupt stubs
+// Interrupts (SimInterrupts.h)
 void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode) {
-    // Stub implementation
-    (void)interruptNum;
-    (void)userFunc;
-    (void)mode;
+    irqAttach(interruptNum, userFunc, (uint8_t)mode);
 }
 
 void detachInterrupt(uint8_t interruptNum) {
-    // Stub implementation
-    (void)interruptNum;
+    irqDetach(interruptNum);
+}
+
+void interrupts(void) {
+    irqEnable(true);
+}
+
+void noInterrupts(void) {
+    irqEnable(false);
 }
 
 // Random number functions
+// Each instance keeps its own generator (SimRandom.h) so simulated boards
+// do not share a stream
 void randomSeed(unsigned long seed) {
     if (seed != 0) {
-        srand(seed);
+        SimContext *ctx = simContext();
+        simRandomSeed(ctx->random, (uint32_t)seed, ctx->id);
     }
 }
 
-long random(long howbig) {
-    if (howbig == 0) {
-        return 0;
+// Uniform in [0, bound)
+static unsigned long randomBelow(unsigned long bound) {
+    SimRandom &rng = simContext()->random;
+#if !defined(__AVR__)
+    if (bound > 0xFFFFFFFFUL) {
+        // Ranges only 64-bit longs can express: the same reduction on
+        // 64-bit draws
+        unsigned __int128 m;
+        uint64_t threshold = (0ULL - bound) % bound;
+        do {
+            uint64_t x = ((uint64_t)simRandomNext(rng) << 32) | simRandomNext(rng);
+            m = (unsigned __int128)x * bound;
+        } while ((uint64_t)m < threshold);
+        return (unsigned long)(m >> 64);
     }
-    return rand() % howbig;
+#endif
+    return simRandomBelow(rng, (uint32_t)bound);
+}
+
+long random(long howbig) {
+    // Like random() % howbig on a board, the result is never negative
+    return (long)randomBelow(howbig < 0 ? 0UL - (unsigned long)howbig : (unsigned long)howbig);
 }
 
 long random(long howsmall, long howbig) {
     if (howsmall >= howbig) {
         return howsmall;
     }
-    long diff = howbig - howsmall;
-    return random(diff) + howsmall;
+    // The difference may not fit in a long, but it does in an unsigned one
+    unsigned long diff = (unsigned long)howbig - (unsigned long)howsmall;
+    return (long)(randomBelow(diff) + (unsigned long)howsmall);
 }
 
 // Math utility functions
@@ -10,9 +10,20 @@
 #include <stdbool.h>
 #include <string.h>
 #include <math.h>
+#include <inttypes.h>
+
+#if defined(__AVR__)
 #include <avr/pgmspace.h>
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#else
+// Host build (unit tests, profiling): program memory is ordinary memory
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define strlen_P(s) strlen(s)
+#define memcpy_P(dest, src, n) memcpy((dest), (src), (n))
+#endif
 
 #ifdef __cplusplus
 extern "C"{
@@ -26,6 +37,11 @@ extern "C"{
 #define OUTPUT 0x1
 #define INPUT_PULLUP 0x2
 
+// Interrupt trigger modes (LOW is level-triggered)
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
 // Pin Definitions for Arduino Uno
 #define LED_BUILTIN 13
 
@@ -82,30 +98,137 @@ uint8_t shiftIn(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder);
 
 void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode);
 void detachInterrupt(uint8_t interruptNum);
+void interrupts(void);
+void noInterrupts(void);
 
 // Random number functions
 void randomSeed(unsigned long seed);
-long random(long howbig);
-long random(long howsmall, long howbig);
 
 // Math utility functions
 long map(long x, long in_min, long in_max, long out_min, long out_max);
+#ifndef __cplusplus
+// C only; C++ gets the function templates below, which evaluate each
+// argument once
 #define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
 #define min(a,b) ((a)<(b)?(a):(b))
 #define max(a,b) ((a)>(b)?(a):(b))
 #define abs(x) ((x)>0?(x):-(x))
+#endif
 
 void setup(void);
 void loop(void);
 
 // Get external prototypes
 #include "binary.h"
+#include "pins_arduino.h"
+
+// Port-wide digital output. digitalWritePort() sets the bits of one port
+// selected by mask to the matching bits of value in a single update.
+// A PinGroup maps an arbitrary list of pins onto their ports once, so
+// pinGroupWrite() costs one register update per port touched instead of
+// one digitalWrite() per pin; bit i of bits drives pins[i].
+#define PIN_GROUP_MAX_PINS NUM_DIGITAL_PINS
+
+typedef struct {
+    uint8_t count;
+    uint8_t port[PIN_GROUP_MAX_PINS];
+    uint8_t mask[PIN_GROUP_MAX_PINS];
+    uint8_t port_mask[NUM_PORTS];   // all group bits on each port
+} PinGroup;
+
+void digitalWritePort(uint8_t port, uint8_t mask, uint8_t value);
+uint8_t digitalReadPort(uint8_t port);
+void pinGroupInit(PinGroup *group, const uint8_t *pins, uint8_t count);
+void pinGroupWrite(const PinGroup *group, uint32_t bits);
 
 #ifdef __cplusplus
 } // extern "C"
 #endif
 
 #ifdef __cplusplus
+// Overloaded, so these need C++ linkage
+long random(long howbig);
+long random(long howsmall, long howbig);
+
+// min/max/abs/constrain as functions: each argument is evaluated once,
+// so max(analogRead(A0), x) converts once, and constant arguments still
+// fold. Mixed argument types give the type the macros' ?: would.
+template <typename T> struct ArduinoValue { typedef T type; };
+template <typename T> struct ArduinoValue<T &> { typedef T type; };
+template <typename T> struct ArduinoValue<const T> { typedef T type; };
+template <typename T> struct ArduinoValue<const T &> { typedef T type; };
+
+template <typename T, typename U>
+constexpr typename ArduinoValue<decltype(true ? T() : U())>::type min(const T &a, const U &b) {
+    return a < b ? a : b;
+}
+
+template <typename T, typename U>
+constexpr typename ArduinoValue<decltype(true ? T() : U())>::type max(const T &a, const U &b) {
+    return a > b ? a : b;
+}
+
+// For types <stdlib.h> and <math.h> have no abs() overload for
+template <typename T>
+constexpr T abs(const T &x) {
+    return x > 0 ? x : -x;
+}
+
+template <typename T, typename L, typename H>
+constexpr T constrain(const T &amt, const L &low, const H &high) {
+    return amt < low ? low : (amt > high ? high : amt);
+}
+
+#include "SimContext.h"
+#include "SimAdc.h"
+#include "SimInterrupts.h"
+
+// Compile-time pin access. With a constant pin the port index and bit
+// mask fold away, leaving one read-modify-write of the port register.
+// digitalWriteFast<13>(HIGH) requires a constant pin; the two-argument
+// forms fall back to the table-driven functions when it is not.
+template <uint8_t pin>
+inline void pinModeFast(uint8_t mode) {
+    static_assert(pin < NUM_DIGITAL_PINS, "not a digital pin");
+    simPinsSetMode(simContext()->pins, PIN_TO_PORT_RULE(pin), PIN_TO_BIT_MASK_RULE(pin), mode);
+}
+
+template <uint8_t pin>
+inline void digitalWriteFast(uint8_t val) {
+    static_assert(pin < NUM_DIGITAL_PINS, "not a digital pin");
+    simPinsWrite(simContext()->pins, PIN_TO_PORT_RULE(pin), PIN_TO_BIT_MASK_RULE(pin), val);
+}
+
+template <uint8_t pin>
+inline int digitalReadFast(void) {
+    static_assert(pin < NUM_DIGITAL_PINS, "not a digital pin");
+    return simPinsRead(simContext()->pins, PIN_TO_PORT_RULE(pin), PIN_TO_BIT_MASK_RULE(pin));
+}
+
+__attribute__((always_inline)) inline void pinModeFast(uint8_t pin, uint8_t mode) {
+    if (__builtin_constant_p(pin) && pin < NUM_DIGITAL_PINS) {
+        simPinsSetMode(simContext()->pins, PIN_TO_PORT_RULE(pin), PIN_TO_BIT_MASK_RULE(pin), mode);
+    } else {
+        pinMode(pin, mode);
+    }
+}
+
+__attribute__((always_inline)) inline void digitalWriteFast(uint8_t pin, uint8_t val) {
+    if (__builtin_constant_p(pin) && __builtin_constant_p(val) && pin < NUM_DIGITAL_PINS) {
+        simPinsWrite(simContext()->pins, PIN_TO_PORT_RULE(pin), PIN_TO_BIT_MASK_RULE(pin), val);
+    } else {
+        digitalWrite(pin, val);
+    }
+}
+
+__attribute__((always_inline)) inline int digitalReadFast(uint8_t pin) {
+    if (__builtin_constant_p(pin) && pin < NUM_DIGITAL_PINS) {
+        return simPinsRead(simContext()->pins, PIN_TO_PORT_RULE(pin), PIN_TO_BIT_MASK_RULE(pin));
+    }
+    return digitalRead(pin);
+}
+
+#include "FastMap.h"
 #include "WCharacter.h"
 #include "WString.h"
 #include "HardwareSerial.h"
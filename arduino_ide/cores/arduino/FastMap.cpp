@@ -0,0 +1,133 @@
+/*
+  FastMap.cpp - Division-free and overflow-safe forms of map()
+*/
+
+#if !defined(__AVR__)
+// Standard library headers must come before Arduino.h and its macros
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#endif
+
+#include "Arduino.h"
+#include <limits.h>
+
+// Holds the product of two distances between longs, each of which fits
+// an unsigned long
+#if ULONG_MAX > 0xFFFFFFFFUL
+typedef unsigned __int128 MapWideUnsigned;
+#else
+typedef uint64_t MapWideUnsigned;
+#endif
+
+// |a - b|, and whether a - b is negative
+static inline MapWideUnsigned mapDistance(long a, long b, bool &negative) {
+    negative = a < b;
+    return negative ? (unsigned long)b - (unsigned long)a : (unsigned long)a - (unsigned long)b;
+}
+
+long mapWide(long x, long in_min, long in_max, long out_min, long out_max) {
+    if (in_min == in_max) {
+        return out_min;
+    }
+    // On magnitudes, so the quotient truncates toward zero as map()'s does
+    // and even full-range spans cannot overflow
+    bool offset_negative, scale_negative, span_negative;
+    MapWideUnsigned offset = mapDistance(x, in_min, offset_negative);
+    MapWideUnsigned scale = mapDistance(out_max, out_min, scale_negative);
+    MapWideUnsigned span = mapDistance(in_max, in_min, span_negative);
+    unsigned long scaled = (unsigned long)(offset * scale / span);
+    bool negative = offset_negative ^ scale_negative ^ span_negative;
+    return (long)(negative ? (unsigned long)out_min - scaled : (unsigned long)out_min + scaled);
+}
+
+static inline int16_t saturate16(long value) {
+    return value < INT16_MIN ? INT16_MIN : value > INT16_MAX ? INT16_MAX : (int16_t)value;
+}
+
+#if defined(__SSE2__) && !defined(__AVR__)
+// Eight samples in double precision. For |(x - in_min) * (out_max - out_min)|
+// below 2^53 the product is exact, and the rounded quotient cannot reach
+// an integer the exact one does not (their distance is at least
+// 1 / |in_max - in_min|), so truncating it matches the integer formula.
+static size_t mapSamplesVector(const int16_t *in, int16_t *out, size_t count,
+                               double in_min, double scale, double span, double out_min) {
+    size_t i = 0;
+#if defined(__AVX__)
+    const __m256d from4 = _mm256_set1_pd(in_min);
+    const __m256d scale4 = _mm256_set1_pd(scale);
+    const __m256d span4 = _mm256_set1_pd(span);
+    const __m256d to4 = _mm256_set1_pd(out_min);
+    const __m256d low4 = _mm256_set1_pd(INT16_MIN);
+    const __m256d high4 = _mm256_set1_pd(INT16_MAX);
+    // Quotients are clamped before conversion so they fit an int32
+    const __m256d limit4 = _mm256_set1_pd(1e9);
+    for (; i + 8 <= count; i += 8) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(in + i));
+        __m128i halves[2] = {
+            _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16),
+            _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16),
+        };
+        __m128i mapped[2];
+        for (int h = 0; h < 2; ++h) {
+            __m256d q = _mm256_div_pd(_mm256_mul_pd(_mm256_sub_pd(_mm256_cvtepi32_pd(halves[h]), from4), scale4), span4);
+            q = _mm256_min_pd(_mm256_max_pd(q, _mm256_sub_pd(_mm256_setzero_pd(), limit4)), limit4);
+            __m256d r = _mm256_add_pd(_mm256_cvtepi32_pd(_mm256_cvttpd_epi32(q)), to4);
+            mapped[h] = _mm256_cvttpd_epi32(_mm256_min_pd(_mm256_max_pd(r, low4), high4));
+        }
+        _mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi32(mapped[0], mapped[1]));
+    }
+#else
+    const __m128d from2 = _mm_set1_pd(in_min);
+    const __m128d scale2 = _mm_set1_pd(scale);
+    const __m128d span2 = _mm_set1_pd(span);
+    const __m128d to2 = _mm_set1_pd(out_min);
+    const __m128d low2 = _mm_set1_pd(INT16_MIN);
+    const __m128d high2 = _mm_set1_pd(INT16_MAX);
+    // Quotients are clamped before conversion so they fit an int32
+    const __m128d limit2 = _mm_set1_pd(1e9);
+    for (; i + 8 <= count; i += 8) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(in + i));
+        __m128i words[2] = {
+            _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16),
+            _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16),
+        };
+        __m128i mapped[2];
+        for (int h = 0; h < 2; ++h) {
+            __m128i pair[2];
+            for (int p = 0; p < 2; ++p) {
+                __m128i ints = p == 0 ? words[h] : _mm_srli_si128(words[h], 8);
+                __m128d q = _mm_div_pd(_mm_mul_pd(_mm_sub_pd(_mm_cvtepi32_pd(ints), from2), scale2), span2);
+                q = _mm_min_pd(_mm_max_pd(q, _mm_sub_pd(_mm_setzero_pd(), limit2)), limit2);
+                __m128d r = _mm_add_pd(_mm_cvtepi32_pd(_mm_cvttpd_epi32(q)), to2);
+                pair[p] = _mm_cvttpd_epi32(_mm_min_pd(_mm_max_pd(r, low2), high2));
+            }
+            mapped[h] = _mm_unpacklo_epi64(pair[0], pair[1]);
+        }
+        _mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi32(mapped[0], mapped[1]));
+    }
+#endif
+    return i;
+}
+#endif
+
+void mapSamples(const int16_t *in, int16_t *out, size_t count,
+                long in_min, long in_max, long out_min, long out_max) {
+    size_t i = 0;
+#if defined(__SSE2__) && !defined(__AVR__)
+    // Largest |x - in_min| over all int16 samples, times the output scale
+    double reach = in_min > 0 ? (double)in_min - INT16_MIN : (double)INT16_MAX - in_min;
+    double scale = (double)out_max - out_min;
+    // Quotients are clamped to +-1e9 in the kernel; with out_min well inside
+    // that the clamped result saturates the same way the exact one does
+    if (in_min != in_max && reach * (scale < 0 ? -scale : scale) < 9007199254740992.0
+            && out_min > -900000000L && out_min < 900000000L) {
+        i = mapSamplesVector(in, out, count, in_min, scale, (double)in_max - in_min, out_min);
+    }
+#endif
+    for (; i < count; ++i) {
+        out[i] = saturate16(mapWide(in[i], in_min, in_max, out_min, out_max));
+    }
+}
@@ -0,0 +1,92 @@
+/*
+  FastMap.h - Division-free and overflow-safe forms of map()
+
+  map(x, in_min, in_max, out_min, out_max) divides on every call, a
+  32-bit division costing about 600 cycles on AVR, and its intermediate
+  product overflows a long for wide ranges. The forms here return what
+  the formula gives when evaluated exactly, truncating toward zero:
+
+    map<InMin, InMax, OutMin, OutMax>(x)  ranges known at compile time: x
+                                          inside the input range costs a
+                                          multiply and a shift; x outside
+                                          it falls back to mapWide()
+    mapWide(x, ...)                       any ranges, computed on 64-bit
+                                          (128-bit for 64-bit longs)
+                                          intermediates
+    mapSamples(in, out, count, ...)       whole int16 buffers such as ADC
+                                          captures; SSE2/AVX on host builds
+
+  For 0 <= a <= span, a * scale / span rounded down equals
+  (a * multiplier) >> shift once 2^shift > span^2 and multiplier is
+  2^shift * scale / span rounded up; the error term then stays below
+  1 / span, too small to cross the next integer.
+*/
+
+#ifndef FastMap_h
+#define FastMap_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Same result as map() without its overflow; an empty input range maps
+// everything to out_min
+long mapWide(long x, long in_min, long in_max, long out_min, long out_max);
+
+// out[i] = mapWide(in[i], ...), saturated to the int16_t range. in and out
+// may be the same buffer.
+void mapSamples(const int16_t *in, int16_t *out, size_t count,
+                long in_min, long in_max, long out_min, long out_max);
+
+// Smallest shift with 2^shift > square, 64 if none fits
+constexpr uint8_t mapShift(uint64_t square, uint8_t shift = 0) {
+    return shift == 64 || (square >> shift) == 0 ? shift : mapShift(square, shift + 1);
+}
+
+// Bit length of value
+constexpr uint8_t mapBits(uint64_t value) {
+    return mapShift(value);
+}
+
+template <long InMin, long InMax, long OutMin, long OutMax>
+struct MapConstants {
+    static_assert(InMin != InMax, "map() input range is empty");
+
+    static constexpr bool rising = InMax > InMin;
+    static constexpr unsigned long span =
+        rising ? (unsigned long)InMax - (unsigned long)InMin : (unsigned long)InMin - (unsigned long)InMax;
+    static constexpr unsigned long scale =
+        OutMax > OutMin ? (unsigned long)OutMax - (unsigned long)OutMin : (unsigned long)OutMin - (unsigned long)OutMax;
+    // Inside the input range x - InMin has the sign of InMax - InMin
+    static constexpr bool negative = OutMax < OutMin;
+    static constexpr uint8_t shift = span < 0x80000000UL ? mapShift((uint64_t)span * span) : 64;
+    // The product a * multiplier must fit 64 bits
+    static constexpr bool fast = shift + mapBits(scale) + 1 <= 64;
+    static constexpr uint64_t multiplier =
+        fast ? (((uint64_t)scale << shift) + span - 1) / span : 0;
+    // ... and 32 bits whenever possible, which matters on AVR
+    static constexpr bool narrow = fast && shift + mapBits(scale) + 1 <= 32;
+};
+
+// x relative to the start of the input range; larger than span if x is
+// outside it
+template <long InMin, long InMax>
+constexpr unsigned long mapOffset(long x) {
+    return InMax > InMin ? (unsigned long)x - (unsigned long)InMin : (unsigned long)InMin - (unsigned long)x;
+}
+
+template <typename C>
+constexpr unsigned long mapScaled(unsigned long a) {
+    return C::narrow ? (unsigned long)(((uint32_t)a * (uint32_t)C::multiplier) >> C::shift)
+                     : (unsigned long)(((uint64_t)a * C::multiplier) >> C::shift);
+}
+
+template <long InMin, long InMax, long OutMin, long OutMax>
+constexpr long map(long x) {
+    typedef MapConstants<InMin, InMax, OutMin, OutMax> C;
+    return !C::fast || mapOffset<InMin, InMax>(x) > C::span
+        ? mapWide(x, InMin, InMax, OutMin, OutMax)
+        : C::negative ? (long)((unsigned long)OutMin - mapScaled<C>(mapOffset<InMin, InMax>(x)))
+                      : (long)((unsigned long)OutMin + mapScaled<C>(mapOffset<InMin, InMax>(x)));
+}
+
+#endif
@@ -0,0 +1,557 @@
+/*
+  HardwareSerial.cpp - Buffered serial port of a simulated board
+*/
+
+#if !defined(__AVR__)
+// Standard library headers must come before Arduino.h and its macros
+#include <thread>
+#endif
+
+#include "Arduino.h"
+#include "NumberFormat.h"
+
+#if !defined(__AVR__)
+#include <stdio.h>
+#include <unistd.h>
+#include "SerialBackend.h"
+#endif
+
+// Bytes moved per read() from a polled backend
+#define SERIAL_POLL_CHUNK 256
+
+HardwareSerial Serial;
+
+static SerialPort *currentPort(void) {
+    return simContext()->serial;
+}
+
+static SerialPort *ensurePort(void) {
+    SimContext *ctx = simContext();
+    if (ctx->serial == NULL) {
+        SerialPort *port = new SerialPort();
+        port->rx_capacity = SERIAL_RX_BUFFER_SIZE;
+        port->tx_capacity = SERIAL_TX_BUFFER_SIZE;
+        // Host threads using the channel may look the port up concurrently
+        __atomic_store_n(&ctx->serial, port, __ATOMIC_RELEASE);
+    }
+    return ctx->serial;
+}
+
+static bool portPolled(SerialPort *port) {
+#if defined(__AVR__)
+    (void)port;
+    return true;
+#else
+    return port->backend == NULL || port->backend->polled();
+#endif
+}
+
+// Hands buffered TX bytes to a polled backend. Without a backend the
+// bytes are dropped, as on an unconnected TX line.
+static void drainTx(SerialPort *port) {
+    const uint8_t *first;
+    const uint8_t *second;
+    size_t first_size;
+    size_t second_size;
+    size_t pending = port->tx.spans(first, first_size, second, second_size);
+    if (pending == 0) {
+        return;
+    }
+#if !defined(__AVR__)
+    if (port->backend != NULL) {
+        pending = port->backend->write(first, first_size, second, second_size);
+    }
+#endif
+    port->tx.consume(pending);
+}
+
+static void pollRx(SerialPort *port) {
+#if !defined(__AVR__)
+    if (port->backend == NULL || !port->backend->polled()) {
+        return;
+    }
+    uint8_t chunk[SERIAL_POLL_CHUNK];
+    size_t room = port->rx.space();
+    if (room > sizeof(chunk)) {
+        room = sizeof(chunk);
+    }
+    size_t count = port->backend->read(chunk, room);
+    port->rx.pushBulk(chunk, count);
+#else
+    (void)port;
+#endif
+}
+
+// Makes room in a full TX ring: polled backends are drained in place,
+// the channel waits for its host reader. False when the caller should
+// drop its output because the reader has stalled.
+static bool waitForTxSpace(SerialPort *port) {
+    if (portPolled(port)) {
+        drainTx(port);
+        return true;
+    }
+#if !defined(__AVR__)
+    if (__atomic_load_n(&port->tx_stalled, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    uint64_t deadline_ns = clockHostNanos() + SERIAL_CHANNEL_STALL_US * 1000ULL;
+    while (port->tx.space() == 0) {
+        if (clockHostNanos() >= deadline_ns) {
+            __atomic_store_n(&port->tx_stalled, true, __ATOMIC_RELEASE);
+            return false;
+        }
+        std::this_thread::yield();
+    }
+#endif
+    return true;
+}
+
+// Waits until count bytes are free at the TX write position. False if the
+// ring can never hold that many.
+static bool reserveTx(SerialPort *port, size_t count) {
+    if (count > port->tx.capacity()) {
+        return false;
+    }
+    while (port->tx.space() < count) {
+        if (!waitForTxSpace(port)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void HardwareSerial::begin(unsigned long baud) {
+    SerialPort *port = ensurePort();
+    if (port->rx.capacity() < port->rx_capacity || port->tx.capacity() < port->tx_capacity) {
+        // Host threads on the channel keep off the rings until they are set up
+        __atomic_store_n(&port->ready, false, __ATOMIC_RELEASE);
+        port->rx.allocate(port->rx_capacity);
+        port->tx.allocate(port->tx_capacity);
+    }
+    __atomic_store_n(&port->tx_stalled, false, __ATOMIC_RELEASE);
+    __atomic_store_n(&port->ready, port->rx.allocated() && port->tx.allocated(), __ATOMIC_RELEASE);
+#if !defined(__AVR__)
+    if (port->backend == NULL) {
+        if (simContext() == &simDefaultContext) {
+            port->backend = serialBackendFromEnv();
+            if (port->backend == NULL) {
+                fprintf(stderr, "Serial: cannot open ARDUINO_SERIAL=%s, using stdio\n", getenv("ARDUINO_SERIAL"));
+                port->backend = new FdSerialBackend(STDIN_FILENO, STDOUT_FILENO, false, "stdio");
+            }
+        } else {
+            port->backend = new ChannelSerialBackend();
+        }
+    }
+#endif
+    port->baud = baud;
+    port->open = true;
+}
+
+void HardwareSerial::begin(unsigned long baud, uint8_t config) {
+    (void)config;
+    begin(baud);
+}
+
+void HardwareSerial::end() {
+    SerialPort *port = currentPort();
+    if (port == NULL || !port->open) {
+        return;
+    }
+    if (portPolled(port)) {
+        drainTx(port);
+    }
+    port->open = false;
+}
+
+void HardwareSerial::setBufferSizes(size_t rx, size_t tx) {
+    SerialPort *port = ensurePort();
+    port->rx_capacity = rx;
+    port->tx_capacity = tx;
+}
+
+int HardwareSerial::available(void) {
+    SerialPort *port = currentPort();
+    if (port == NULL || !port->open) {
+        return 0;
+    }
+    size_t count = port->rx.size();
+    if (count == 0) {
+        pollRx(port);
+        count = port->rx.size();
+    }
+    return (int)count;
+}
+
+int HardwareSerial::availableForWrite(void) {
+    SerialPort *port = currentPort();
+    if (port == NULL || !port->open) {
+        return 0;
+    }
+    return (int)port->tx.space();
+}
+
+int HardwareSerial::peek(void) {
+    if (available() == 0) {
+        return -1;
+    }
+    return currentPort()->rx.peek();
+}
+
+int HardwareSerial::read(void) {
+    if (available() == 0) {
+        return -1;
+    }
+    uint8_t c = 0;
+    currentPort()->rx.pop(c);
+    return c;
+}
+
+void HardwareSerial::flush(void) {
+    SerialPort *port = currentPort();
+    if (port == NULL || !port->open) {
+        return;
+    }
+    while (port->tx.space() < port->tx.capacity()) {
+        if (!waitForTxSpace(port)) {
+            return;
+        }
+    }
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    SerialPort *port = currentPort();
+    if (port == NULL || !port->open) {
+        return 0;
+    }
+    while (!port->tx.push(c)) {
+        if (!waitForTxSpace(port)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+    SerialPort *port = currentPort();
+    if (port == NULL || !port->open) {
+        return 0;
+    }
+    size_t done = 0;
+    while (done < size) {
+        done += port->tx.pushBulk(buffer + done, size - done);
+        if (done < size && !waitForTxSpace(port)) {
+            return done;
+        }
+    }
+    return size;
+}
+
+size_t HardwareSerial::write(const SerialSpan *spans, size_t count) {
+    SerialPort *port = currentPort();
+    if (port == NULL || !port->open) {
+        return 0;
+    }
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        total += spans[i].size;
+    }
+    if (!reserveTx(port, total)) {
+        for (size_t i = 0; i < count; ++i) {
+            write(spans[i].data, spans[i].size);
+        }
+        return total;
+    }
+    size_t offset = 0;
+    for (size_t i = 0; i < count; ++i) {
+        port->tx.fill(offset, spans[i].data, spans[i].size);
+        offset += spans[i].size;
+    }
+    port->tx.commit(total);
+    return total;
+}
+
+size_t HardwareSerial::write(const char *str) {
+    if (str == NULL) {
+        return 0;
+    }
+    return write((const uint8_t *)str, strlen(str));
+}
+
+size_t HardwareSerial::print(const char *str) {
+    return write(str);
+}
+
+size_t HardwareSerial::print(const __FlashStringHelper *str) {
+#if defined(__AVR__)
+    SerialPort *port = currentPort();
+    if (port == NULL || !port->open || str == NULL) {
+        return 0;
+    }
+    // Copies as much as the ring has room for, one pgm_read_byte() per
+    // slot, and publishes it before waiting for more room
+    const char *p = (const char *)str;
+    size_t total = 0;
+    for (;;) {
+        size_t room = port->tx.space();
+        if (room == 0) {
+            if (!waitForTxSpace(port)) {
+                return total;
+            }
+            continue;
+        }
+        size_t count = 0;
+        uint8_t c;
+        while (count < room && (c = pgm_read_byte(p + count)) != 0) {
+            port->tx.slot(count++) = c;
+        }
+        port->tx.commit(count);
+        total += count;
+        if (count < room) {
+            return total;
+        }
+        p += count;
+    }
+#else
+    // Program memory is ordinary memory here
+    return write((const char *)str);
+#endif
+}
+
+size_t HardwareSerial::print(char c) {
+    return write((uint8_t)c);
+}
+
+size_t HardwareSerial::print(const String &s) {
+    return write((const uint8_t *)s.c_str(), s.length());
+}
+
+// Number formatting writes digits straight into the TX ring: the text is
+// sized first, then the slots are filled in place and committed at once
+
+// The reserved TX slots, indexable for numberFormat()
+struct TxSlots {
+    SpscRing<uint8_t> *ring;
+    size_t offset;
+
+    uint8_t &operator[](size_t index) const { return ring->slot(offset + index); }
+};
+
+// Byte-at-a-time fallback, most significant digit first, for rings too
+// small to reserve the whole number
+static void writeDigits(unsigned long n, uint8_t base, uint8_t len) {
+    unsigned long power = 1;
+    for (uint8_t i = 1; i < len; ++i) {
+        power *= base;
+    }
+    for (; len > 0; --len) {
+        unsigned long digit = n / power;
+        n -= digit * power;
+        power /= base;
+        Serial.write((uint8_t)pgm_read_byte(&numberDigits[digit]));
+    }
+}
+
+static size_t printNumber(unsigned long n, int base, bool negative) {
+    SerialPort *port = currentPort();
+    if (port == NULL || !port->open) {
+        return 0;
+    }
+    if (base < 2 || base > 36) {
+        base = 10;
+    }
+    uint8_t len = numberLength(n, (uint8_t)base);
+    size_t total = len + (negative ? 1 : 0);
+    if (!reserveTx(port, total)) {
+        if (negative) {
+            Serial.write('-');
+        }
+        writeDigits(n, (uint8_t)base, len);
+        return total;
+    }
+    TxSlots out = { &port->tx, 0 };
+    if (negative) {
+        out[0] = '-';
+        out.offset = 1;
+    }
+    numberFormat(out, n, (uint8_t)base, len);
+    port->tx.commit(total);
+    return total;
+}
+
+size_t HardwareSerial::print(long n, int base) {
+    if (base == 0) {
+        return write((uint8_t)n);
+    }
+    if (base == 10 && n < 0) {
+        return printNumber(0UL - (unsigned long)n, 10, true);
+    }
+    return printNumber((unsigned long)n, base, false);
+}
+
+size_t HardwareSerial::print(unsigned long n, int base) {
+    if (base == 0) {
+        return write((uint8_t)n);
+    }
+    return printNumber(n, base, false);
+}
+
+size_t HardwareSerial::print(double number, int digits) {
+    SerialPort *port = currentPort();
+    if (port == NULL || !port->open) {
+        return 0;
+    }
+    FloatDigits parts;
+    floatDigitsSplit(number, digits > 0 ? (uint8_t)digits : 0, parts);
+    if (parts.special != NULL) {
+        return write(parts.special);
+    }
+    uint8_t whole_len = numberLength(parts.whole, 10);
+    size_t total = (parts.negative ? 1 : 0) + whole_len;
+    if (digits > 0) {
+        total += 1 + parts.fraction_digits;
+    }
+    if (reserveTx(port, total)) {
+        TxSlots out = { &port->tx, 0 };
+        if (parts.negative) {
+            out[0] = '-';
+            out.offset = 1;
+        }
+        numberFormat(out, parts.whole, 10, whole_len);
+        if (digits > 0) {
+            out.offset += whole_len;
+            out[0] = '.';
+            out.offset += 1;
+            numberFormat(out, parts.fraction, 10, parts.fraction_digits);
+        }
+        port->tx.commit(total);
+    } else {
+        if (parts.negative) {
+            write('-');
+        }
+        writeDigits(parts.whole, 10, whole_len);
+        if (digits > 0) {
+            write('.');
+            writeDigits(parts.fraction, 10, parts.fraction_digits);
+        }
+    }
+    // Digits past what one unsigned long holds, one at a time as Arduino does
+    double rest = parts.rest;
+    for (int i = parts.fraction_digits; i < digits; ++i) {
+        rest *= 10.0;
+        uint8_t digit = (uint8_t)rest;
+        rest -= digit;
+        write((uint8_t)('0' + digit));
+        total++;
+    }
+    return total;
+}
+
+size_t HardwareSerial::println(const char *str) {
+    return print(str) + println();
+}
+
+size_t HardwareSerial::println(const __FlashStringHelper *str) {
+    return print(str) + println();
+}
+
+size_t HardwareSerial::println(char c) {
+    return print(c) + println();
+}
+
+size_t HardwareSerial::println(const String &s) {
+    return print(s) + println();
+}
+
+size_t HardwareSerial::println(void) {
+    return write("\r\n");
+}
+
+void serialEventRun(void) {
+    SerialPort *port = currentPort();
+    if (port == NULL || !port->open) {
+        return;
+    }
+    if (portPolled(port)) {
+        drainTx(port);
+    }
+    if (serialEvent && Serial.available()) {
+        serialEvent();
+    }
+}
+
+void serialDrainTx(void) {
+    SerialPort *port = currentPort();
+    if (port != NULL && port->open && portPolled(port)) {
+        drainTx(port);
+    }
+}
+
+void serialFreePort(SerialPort *port) {
+    if (port == NULL) {
+        return;
+    }
+#if !defined(__AVR__)
+    delete port->backend;
+#endif
+    delete port;
+}
+
+#if !defined(__AVR__)
+
+void serialSetBackend(SerialBackend *backend) {
+    SerialPort *port = ensurePort();
+    delete port->backend;
+    port->backend = backend;
+}
+
+struct ScheduledInput {
+    size_t size;
+    uint8_t data[1];
+};
+
+static void deliverInput(void *arg) {
+    ScheduledInput *input = (ScheduledInput *)arg;
+    SerialPort *port = currentPort();
+    if (port != NULL && port->open) {
+        // Bytes that find the RX ring full are lost, like a UART overrun
+        port->rx.pushBulk(input->data, input->size);
+    }
+    free(input);
+}
+
+bool serialScheduleInput(uint64_t time_us, const uint8_t *data, size_t size) {
+    ScheduledInput *input = (ScheduledInput *)malloc(sizeof(ScheduledInput) + size);
+    if (input == NULL) {
+        return false;
+    }
+    input->size = size;
+    memcpy(input->data, data, size);
+    if (!schedulerPost(time_us, SIM_EVENT_SERIAL_RX, deliverInput, input)) {
+        free(input);
+        return false;
+    }
+    return true;
+}
+
+size_t serialChannelRead(SimContext *ctx, uint8_t *buffer, size_t size) {
+    SerialPort *port = __atomic_load_n(&ctx->serial, __ATOMIC_ACQUIRE);
+    if (port == NULL || !__atomic_load_n(&port->ready, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+    size_t count = port->tx.popBulk(buffer, size);
+    if (count > 0) {
+        // A reader is back: the sketch may wait for it again
+        __atomic_store_n(&port->tx_stalled, false, __ATOMIC_RELEASE);
+    }
+    return count;
+}
+
+size_t serialChannelWrite(SimContext *ctx, const uint8_t *data, size_t size) {
+    SerialPort *port = __atomic_load_n(&ctx->serial, __ATOMIC_ACQUIRE);
+    if (port == NULL || !__atomic_load_n(&port->ready, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+    return port->rx.pushBulk(data, size);
+}
+
+#endif
@@ -1,47 +1,134 @@
-/* HardwareSerial.h - Hardware serial stub */
+/* HardwareSerial.h - Buffered serial port of a simulated board */
 #ifndef HardwareSerial_h
 #define HardwareSerial_h
 
 #include <inttypes.h>
 #include "WString.h"
+#include "RingBuffer.h"
 
+// Ring capacities, rounded up to a power of two. Override before
+// Serial.begin() with Serial.setBufferSizes().
+#if !defined(SERIAL_TX_BUFFER_SIZE)
+#if defined(__AVR__)
+#define SERIAL_TX_BUFFER_SIZE 64
+#else
+#define SERIAL_TX_BUFFER_SIZE 16384
+#endif
+#endif
+#if !defined(SERIAL_RX_BUFFER_SIZE)
+#if defined(__AVR__)
+#define SERIAL_RX_BUFFER_SIZE 64
+#else
+#define SERIAL_RX_BUFFER_SIZE 16384
+#endif
+#endif
+
+class SerialBackend;
+
+// One piece of a scatter-gather write
+struct SerialSpan {
+    const uint8_t *data;
+    size_t size;
+};
+
+// Per-instance port state, owned by the SimContext
+struct SerialPort {
+    SpscRing<uint8_t> rx;
+    SpscRing<uint8_t> tx;
+    SerialBackend *backend;
+    size_t rx_capacity;
+    size_t tx_capacity;
+    unsigned long baud;
+    bool open;
+    bool ready;                 // rings allocated, published to host threads
+    bool tx_stalled;            // channel gave up waiting for its reader
+    uint8_t telemetry_seq;      // next frame number, see Telemetry.h
+};
+
+// Serial is a view of the running instance's SerialPort, so the same
+// object works for every simulated board in the process
 class HardwareSerial {
 public:
-    void begin(unsigned long baud) {}
-    void begin(unsigned long baud, uint8_t config) {}
-    void end() {}
-
-    int available(void) { return 0; }
-    int peek(void) { return -1; }
-    int read(void) { return -1; }
-    void flush(void) {}
-
-    size_t write(uint8_t c) { return 1; }
-    size_t write(const uint8_t *buffer, size_t size) { return size; }
-    size_t write(const char *str) { return 0; }
-
-    void print(const char *str) {}
-    void print(char c) {}
-    void print(int n, int base = DEC) {}
-    void print(unsigned int n, int base = DEC) {}
-    void print(long n, int base = DEC) {}
-    void print(unsigned long n, int base = DEC) {}
-    void print(double n, int digits = 2) {}
-    void print(const String &s) {}
-
-    void println(const char *str) {}
-    void println(char c) {}
-    void println(int n, int base = DEC) {}
-    void println(unsigned int n, int base = DEC) {}
-    void println(long n, int base = DEC) {}
-    void println(unsigned long n, int base = DEC) {}
-    void println(double n, int digits = 2) {}
-    void println(const String &s) {}
-    void println(void) {}
+    void begin(unsigned long baud);
+    void begin(unsigned long baud, uint8_t config);
+    void end();
+
+    // Takes effect on the next begin()
+    void setBufferSizes(size_t rx, size_t tx);
+
+    int available(void);
+    int availableForWrite(void);
+    int peek(void);
+    int read(void);
+    void flush(void);
+
+    size_t write(uint8_t c);
+    size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *str);
+    // Queues all spans as one contiguous chunk of output
+    size_t write(const SerialSpan *spans, size_t count);
+
+    size_t print(const char *str);
+    // Streams an F() string from program memory, never copying it to RAM
+    size_t print(const __FlashStringHelper *str);
+    size_t print(char c);
+    // Base 0 writes the value as a single byte; only DEC prints a sign
+    size_t print(int n, int base = DEC) { return print((long)n, base); }
+    size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+    size_t print(long n, int base = DEC);
+    size_t print(unsigned long n, int base = DEC);
+    size_t print(double n, int digits = 2);
+    size_t print(const String &s);
+
+    size_t println(const char *str);
+    size_t println(const __FlashStringHelper *str);
+    size_t println(char c);
+    size_t println(int n, int base = DEC) { return print(n, base) + println(); }
+    size_t println(unsigned int n, int base = DEC) { return print(n, base) + println(); }
+    size_t println(long n, int base = DEC) { return print(n, base) + println(); }
+    size_t println(unsigned long n, int base = DEC) { return print(n, base) + println(); }
+    size_t println(double n, int digits = 2) { return print(n, digits) + println(); }
+    size_t println(const String &s);
+    size_t println(void);
 
     operator bool() { return true; }
 };
 
 extern HardwareSerial Serial;
 
+// Called after every loop() iteration: hands buffered TX data to the
+// backend, collects pending input and runs serialEvent() if defined
+void serialEventRun(void);
+extern void serialEvent(void) __attribute__((weak));
+
+// Hands buffered TX bytes to a polled backend. The scheduler calls it
+// whenever virtual time moves, so output goes out during delay() the way
+// a UART keeps sending in the background.
+void serialDrainTx(void);
+
+// Frees the instance's port, used when a SimContext is destroyed
+void serialFreePort(SerialPort *port);
+
+#if !defined(__AVR__)
+// Replaces the running instance's backend; the port takes ownership
+void serialSetBackend(SerialBackend *backend);
+
+// Queues bytes to arrive on RX at simulated time time_us. Polled
+// backends only: with the channel, RX belongs to the host thread.
+bool serialScheduleInput(uint64_t time_us, const uint8_t *data, size_t size);
+
+// In-process channel, called from a host thread. Each direction allows
+// one host thread: serialChannelRead() consumes TX, serialChannelWrite()
+// feeds RX. Both return 0 until Serial.begin() has set up the rings.
+// Buffer sizes must not change while a host thread uses the channel.
+//
+// When TX is full the sketch waits up to SERIAL_CHANNEL_STALL_US of host
+// time for the reader; then output is dropped, as on the pty backend with
+// nobody attached, until serialChannelRead() takes bytes again.
+#define SERIAL_CHANNEL_STALL_US 100000
+struct SimContext;
+size_t serialChannelRead(SimContext *ctx, uint8_t *buffer, size_t size);
+size_t serialChannelWrite(SimContext *ctx, const uint8_t *data, size_t size);
+#endif
+
 #endif
@@ -0,0 +1,100 @@
+/*
+  NumberFormat.cpp - Allocation-free integer and float to text conversion
+*/
+
+#include "Arduino.h"
+#include "NumberFormat.h"
+
+const char numberDigits[] PROGMEM = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+const char numberPairs10[] PROGMEM =
+    "0001020304050607080910111213141516171819202122232425262728293031"
+    "3233343536373839404142434445464748495051525354555657585960616263"
+    "6465666768697071727374757677787980818283848586878889909192939495"
+    "96979899";
+
+const char numberPairs16[] PROGMEM =
+    "000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F"
+    "202122232425262728292A2B2C2D2E2F303132333435363738393A3B3C3D3E3F"
+    "404142434445464748494A4B4C4D4E4F505152535455565758595A5B5C5D5E5F"
+    "606162636465666768696A6B6C6D6E6F707172737475767778797A7B7C7D7E7F"
+    "808182838485868788898A8B8C8D8E8F909192939495969798999A9B9C9D9E9F"
+    "A0A1A2A3A4A5A6A7A8A9AAABACADAEAFB0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+    "C0C1C2C3C4C5C6C7C8C9CACBCCCDCECFD0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+    "E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEFF0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF";
+
+const unsigned long numberPowers10[NUMBER_FRACTION_DIGITS + 1] = {
+    1UL, 10UL, 100UL, 1000UL, 10000UL, 100000UL, 1000000UL, 10000000UL,
+    100000000UL, 1000000000UL,
+#if NUMBER_FRACTION_DIGITS > 9
+    10000000000UL, 100000000000UL, 1000000000000UL, 10000000000000UL,
+    100000000000000UL, 1000000000000000UL, 10000000000000000UL,
+    100000000000000000UL, 1000000000000000000UL, 10000000000000000000UL,
+#endif
+};
+
+uint8_t numberLength(unsigned long n, uint8_t base) {
+    if (n == 0) {
+        return 1;
+    }
+    if (base == 10) {
+        // log10(2) ~ 1233 / 4096 gives the length to within one digit
+        uint8_t bits = (uint8_t)(sizeof(unsigned long) * 8 - __builtin_clzl(n));
+        uint8_t len = (uint8_t)((bits * 1233) >> 12);
+        return n < numberPowers10[len] ? len : len + 1;
+    }
+    if ((base & (base - 1)) == 0) {
+        uint8_t bits = (uint8_t)(sizeof(unsigned long) * 8 - __builtin_clzl(n));
+        uint8_t shift = (uint8_t)__builtin_ctz(base);
+        return (uint8_t)((bits + shift - 1) / shift);
+    }
+    unsigned long limit = n / base;
+    unsigned long power = 1;
+    uint8_t len = 1;
+    while (power <= limit) {
+        power *= base;
+        len++;
+    }
+    return len;
+}
+
+void floatDigitsSplit(double number, uint8_t digits, FloatDigits &out) {
+    out.special = NULL;
+    out.negative = false;
+    out.whole = 0;
+    out.fraction = 0;
+    out.fraction_digits = 0;
+    out.rest = 0.0;
+    if (isnan(number)) {
+        out.special = "nan";
+        return;
+    }
+    if (isinf(number)) {
+        out.special = "inf";
+        return;
+    }
+    if (number > 4294967040.0 || number < -4294967040.0) {
+        out.special = "ovf";
+        return;
+    }
+    if (number < 0.0) {
+        out.negative = true;
+        number = -number;
+    }
+
+    double rounding = 0.5;
+    for (uint8_t i = 0; i < digits; ++i) {
+        rounding /= 10.0;
+    }
+    number += rounding;
+
+    out.whole = (unsigned long)number;
+    out.fraction_digits = digits < NUMBER_FRACTION_DIGITS ? digits : NUMBER_FRACTION_DIGITS;
+    unsigned long scale = numberPowers10[out.fraction_digits];
+    double scaled = (number - (double)out.whole) * (double)scale;
+    out.fraction = (unsigned long)scaled;
+    if (out.fraction >= scale) {
+        out.fraction = scale - 1;
+    }
+    out.rest = scaled - (double)out.fraction;
+}
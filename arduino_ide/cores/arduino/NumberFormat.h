@@ -0,0 +1,93 @@
+/*
+  NumberFormat.h - Allocation-free integer and float to text conversion
+
+  Digits are produced two at a time from lookup tables: "00".."99" for
+  base 10, one byte per two digits for base 16, and a division by base^2
+  (or a shift for powers of two) for the other bases from 2 to 36. The
+  caller sizes the output first with numberLength() and then lets
+  numberFormat() fill it from the right, so text can be written straight
+  into its final place, e.g. the slots of a ring buffer.
+*/
+
+#ifndef NumberFormat_h
+#define NumberFormat_h
+
+#include "Arduino.h"
+#include <limits.h>
+
+// Fraction digits that fit in one unsigned long
+#if ULONG_MAX > 0xFFFFFFFFUL
+#define NUMBER_FRACTION_DIGITS 19
+#else
+#define NUMBER_FRACTION_DIGITS 9
+#endif
+
+extern const char numberDigits[] PROGMEM;
+extern const char numberPairs10[] PROGMEM;
+extern const char numberPairs16[] PROGMEM;
+extern const unsigned long numberPowers10[NUMBER_FRACTION_DIGITS + 1];
+
+// Number of digits of n in base (2..36), at least 1
+uint8_t numberLength(unsigned long n, uint8_t base);
+
+// Writes exactly len digits of n in base to out[0] .. out[len - 1],
+// padding with leading zeros. Out is anything indexable that yields an
+// assignable character, such as char * or a ring buffer view.
+template <typename Out>
+void numberFormat(Out out, unsigned long n, uint8_t base, uint8_t len) {
+    uint8_t pos = len;
+    if (base == 10) {
+        while (pos >= 2) {
+            uint8_t pair = (uint8_t)(n % 100) * 2;
+            n /= 100;
+            pos -= 2;
+            out[pos] = pgm_read_byte(&numberPairs10[pair]);
+            out[pos + 1] = pgm_read_byte(&numberPairs10[pair + 1]);
+        }
+    } else if (base == 16) {
+        while (pos >= 2) {
+            uint16_t pair = (uint16_t)(n & 0xFF) * 2;
+            n >>= 8;
+            pos -= 2;
+            out[pos] = pgm_read_byte(&numberPairs16[pair]);
+            out[pos + 1] = pgm_read_byte(&numberPairs16[pair + 1]);
+        }
+    } else if ((base & (base - 1)) == 0) {
+        uint8_t shift = (uint8_t)__builtin_ctz(base);
+        uint16_t mask = base - 1;
+        while (pos >= 2) {
+            uint16_t pair = (uint16_t)(n & ((1u << (2 * shift)) - 1));
+            n >>= 2 * shift;
+            pos -= 2;
+            out[pos] = pgm_read_byte(&numberDigits[pair >> shift]);
+            out[pos + 1] = pgm_read_byte(&numberDigits[pair & mask]);
+        }
+    } else {
+        uint16_t square = (uint16_t)base * base;
+        while (pos >= 2) {
+            uint16_t pair = (uint16_t)(n % square);
+            n /= square;
+            pos -= 2;
+            out[pos] = pgm_read_byte(&numberDigits[pair / base]);
+            out[pos + 1] = pgm_read_byte(&numberDigits[pair % base]);
+        }
+    }
+    if (pos > 0) {
+        out[0] = pgm_read_byte(&numberDigits[n % base]);
+    }
+}
+
+// A double split the way Arduino prints it: rounded at the last
+// requested digit, integer part limited to 32 bits ("ovf" beyond)
+struct FloatDigits {
+    const char *special;        // "nan", "inf", "ovf" or NULL
+    bool negative;
+    unsigned long whole;
+    unsigned long fraction;     // the first fraction_digits digits
+    uint8_t fraction_digits;
+    double rest;                // remainder for digits past fraction_digits
+};
+
+void floatDigitsSplit(double number, uint8_t digits, FloatDigits &out);
+
+#endif
@@ -0,0 +1,184 @@
+/*
+  RingBuffer.h - Lock-free single-producer/single-consumer ring buffer
+
+  Capacity is a power of two so positions are free-running counters and
+  wrap-around is a mask. Exactly one thread may push and exactly one may
+  pop; neither side takes a lock. Besides element-wise push()/pop(), the
+  producer can fill slots in place and publish them with commit(), and
+  the consumer can read the filled region as at most two contiguous spans
+  and release it with consume().
+*/
+
+#ifndef RingBuffer_h
+#define RingBuffer_h
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Padding that keeps the producer's and consumer's positions on
+// separate cache lines; AVR has no cache and keeps the RAM
+#if defined(__AVR__)
+#define RING_PADDING 1
+#else
+#define RING_PADDING 64
+#endif
+
+template <typename T>
+class SpscRing {
+public:
+    SpscRing() : _buffer(NULL), _capacity(0), _mask(0), _head(0), _tail_cache(0), _tail(0), _head_cache(0) {}
+    ~SpscRing() { release(); }
+
+    // Allocates room for at least capacity elements (rounded up to a
+    // power of two) and empties the ring. Not thread-safe.
+    bool allocate(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        T *buffer = (T *)malloc(size * sizeof(T));
+        if (buffer == NULL) {
+            return false;
+        }
+        release();
+        _buffer = buffer;
+        _capacity = size;
+        _mask = size - 1;
+        _head = _tail_cache = _tail = _head_cache = 0;
+        return true;
+    }
+
+    void release() {
+        free(_buffer);
+        _buffer = NULL;
+        _capacity = 0;
+        _mask = 0;
+        _head = _tail_cache = _tail = _head_cache = 0;
+    }
+
+    bool allocated() const { return _buffer != NULL; }
+    size_t capacity() const { return _capacity; }
+
+    // Producer side
+
+    size_t space() {
+        _tail_cache = __atomic_load_n(&_tail, __ATOMIC_ACQUIRE);
+        return _capacity - (_head - _tail_cache);
+    }
+
+    bool push(const T &item) {
+        if (_head - _tail_cache >= _capacity) {
+            if (space() == 0) {
+                return false;
+            }
+        }
+        _buffer[_head & _mask] = item;
+        __atomic_store_n(&_head, _head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    // Copies up to count elements with at most two memcpy()s; returns how
+    // many fitted
+    size_t pushBulk(const T *items, size_t count) {
+        size_t free_slots = space();
+        if (count > free_slots) {
+            count = free_slots;
+        }
+        fill(0, items, count);
+        __atomic_store_n(&_head, _head + count, __ATOMIC_RELEASE);
+        return count;
+    }
+
+    // Copies count elements to the slots starting offset positions past
+    // the write position, with at most two memcpy()s. offset + count must
+    // not exceed space(); the slots become visible on commit().
+    void fill(size_t offset, const T *items, size_t count) {
+        size_t start = (_head + offset) & _mask;
+        size_t first = _capacity - start;
+        if (first > count) {
+            first = count;
+        }
+        memcpy(_buffer + start, items, first * sizeof(T));
+        memcpy(_buffer, items + first, (count - first) * sizeof(T));
+    }
+
+    // Slot offset positions past the write position; offset must be
+    // below space(). Filled slots become visible on commit().
+    T &slot(size_t offset) { return _buffer[(_head + offset) & _mask]; }
+
+    void commit(size_t count) { __atomic_store_n(&_head, _head + count, __ATOMIC_RELEASE); }
+
+    // Consumer side
+
+    size_t size() {
+        _head_cache = __atomic_load_n(&_head, __ATOMIC_ACQUIRE);
+        return _head_cache - _tail;
+    }
+
+    bool pop(T &item) {
+        if (_tail == _head_cache) {
+            if (size() == 0) {
+                return false;
+            }
+        }
+        item = _buffer[_tail & _mask];
+        __atomic_store_n(&_tail, _tail + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    const T &peek() const { return _buffer[_tail & _mask]; }
+
+    size_t popBulk(T *items, size_t count) {
+        const T *first;
+        const T *second;
+        size_t first_count;
+        size_t second_count;
+        size_t available = spans(first, first_count, second, second_count);
+        if (count > available) {
+            count = available;
+        }
+        size_t n = count < first_count ? count : first_count;
+        memcpy(items, first, n * sizeof(T));
+        memcpy(items + n, second, (count - n) * sizeof(T));
+        consume(count);
+        return count;
+    }
+
+    // Describes the filled region as two spans (the second is empty
+    // unless the data wraps); returns the total element count
+    size_t spans(const T *&first, size_t &first_count, const T *&second, size_t &second_count) {
+        size_t count = size();
+        size_t start = _tail & _mask;
+        first = _buffer + start;
+        first_count = _capacity - start;
+        if (first_count > count) {
+            first_count = count;
+        }
+        second = _buffer;
+        second_count = count - first_count;
+        return count;
+    }
+
+    void consume(size_t count) { __atomic_store_n(&_tail, _tail + count, __ATOMIC_RELEASE); }
+
+private:
+    SpscRing(const SpscRing &);
+    SpscRing &operator=(const SpscRing &);
+
+    T *_buffer;
+    size_t _capacity;
+    size_t _mask;
+
+    // Producer-owned, with a stale copy of the consumer position
+    char _pad_producer[RING_PADDING];
+    size_t _head;
+    size_t _tail_cache;
+
+    // Consumer-owned, with a stale copy of the producer position
+    char _pad_consumer[RING_PADDING];
+    size_t _tail;
+    size_t _head_cache;
+};
+
+#endif
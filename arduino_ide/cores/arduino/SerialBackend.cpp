@@ -0,0 +1,181 @@
+/*
+  SerialBackend.cpp - Where a simulated board's Serial bytes go
+*/
+
+#if !defined(__AVR__)
+
+#include "Arduino.h"
+#include "SerialBackend.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+FdSerialBackend::FdSerialBackend(int in_fd, int out_fd, bool owned, const char *name)
+    : _in_fd(in_fd), _out_fd(out_fd), _owned(owned) {
+    snprintf(_name, sizeof(_name), "%s", name);
+}
+
+FdSerialBackend::~FdSerialBackend() {
+    if (_owned) {
+        if (_in_fd >= 0) {
+            close(_in_fd);
+        }
+        if (_out_fd >= 0 && _out_fd != _in_fd) {
+            close(_out_fd);
+        }
+    }
+}
+
+// Writes everything unless the descriptor fails, in which case the rest
+// is dropped so a closed reader cannot stall the sketch. A non-blocking
+// descriptor that is full is waited for while it has a reader (a PTY
+// slave is open) and dropped once it reports POLLHUP.
+static void writeAll(int fd, struct iovec *iov, int count) {
+    while (count > 0) {
+        if (iov->iov_len == 0) {
+            iov++;
+            count--;
+            continue;
+        }
+        ssize_t n = writev(fd, iov, count);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN) {
+                return;
+            }
+            struct pollfd pfd;
+            pfd.fd = fd;
+            pfd.events = POLLOUT;
+            pfd.revents = 0;
+            if (poll(&pfd, 1, -1) < 0 && errno != EINTR) {
+                return;
+            }
+            if (pfd.revents & (POLLHUP | POLLERR)) {
+                return;
+            }
+            continue;
+        }
+        while (n > 0) {
+            if ((size_t)n >= iov->iov_len) {
+                n -= (ssize_t)iov->iov_len;
+                iov++;
+                count--;
+            } else {
+                iov->iov_base = (uint8_t *)iov->iov_base + n;
+                iov->iov_len -= (size_t)n;
+                n = 0;
+            }
+        }
+    }
+}
+
+size_t FdSerialBackend::write(const uint8_t *first, size_t first_size,
+                              const uint8_t *second, size_t second_size) {
+    // Without an output descriptor this behaves like an unconnected TX line
+    if (_out_fd >= 0) {
+        // Both spans of the ring go out in a single system call
+        struct iovec iov[2];
+        iov[0].iov_base = (void *)first;
+        iov[0].iov_len = first_size;
+        iov[1].iov_base = (void *)second;
+        iov[1].iov_len = second_size;
+        writeAll(_out_fd, iov, 2);
+    }
+    return first_size + second_size;
+}
+
+size_t FdSerialBackend::read(uint8_t *buffer, size_t size) {
+    if (_in_fd < 0 || size == 0) {
+        return 0;
+    }
+    struct pollfd pfd;
+    pfd.fd = _in_fd;
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, 0) <= 0 || !(pfd.revents & POLLIN)) {
+        return 0;
+    }
+    ssize_t n = ::read(_in_fd, buffer, size);
+    return n > 0 ? (size_t)n : 0;
+}
+
+PtySerialBackend::PtySerialBackend(int master_fd, const char *path, const char *link)
+    : FdSerialBackend(master_fd, master_fd, true, path) {
+    _link[0] = '\0';
+    if (link != NULL) {
+        unlink(link);
+        if (symlink(path, link) == 0) {
+            snprintf(_link, sizeof(_link), "%s", link);
+        }
+    }
+}
+
+PtySerialBackend::~PtySerialBackend() {
+    if (_link[0] != '\0') {
+        unlink(_link);
+    }
+}
+
+PtySerialBackend *PtySerialBackend::open(const char *link) {
+    int fd = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+    const char *path = NULL;
+    if (grantpt(fd) == 0 && unlockpt(fd) == 0) {
+        path = ptsname(fd);
+    }
+    if (path == NULL) {
+        close(fd);
+        return NULL;
+    }
+    // Raw mode, so bytes pass without echo or CR/LF translation. The
+    // setting stays with the terminal after this descriptor is closed.
+    int slave = ::open(path, O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (slave >= 0) {
+        struct termios tio;
+        if (tcgetattr(slave, &tio) == 0) {
+            cfmakeraw(&tio);
+            tcsetattr(slave, TCSANOW, &tio);
+        }
+        close(slave);
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return new PtySerialBackend(fd, path, link);
+}
+
+SerialBackend *serialBackendFromEnv(void) {
+    const char *spec = getenv("ARDUINO_SERIAL");
+    if (spec == NULL || *spec == '\0' || strcmp(spec, "stdio") == 0) {
+        return new FdSerialBackend(STDIN_FILENO, STDOUT_FILENO, false, "stdio");
+    }
+    if (strcmp(spec, "channel") == 0) {
+        return new ChannelSerialBackend();
+    }
+    if (strncmp(spec, "file:", 5) == 0) {
+        int fd = open(spec + 5, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            return NULL;
+        }
+        return new FdSerialBackend(-1, fd, true, spec + 5);
+    }
+    if (strcmp(spec, "pty") == 0 || strncmp(spec, "pty:", 4) == 0) {
+        PtySerialBackend *pty = PtySerialBackend::open(spec[3] == ':' ? spec + 4 : NULL);
+        if (pty == NULL) {
+            return NULL;
+        }
+        // Announced on stderr so stdout stays free for the sketch
+        fprintf(stderr, "Serial: pty %s\n", pty->name());
+        return pty;
+    }
+    return NULL;
+}
+
+#endif
@@ -0,0 +1,97 @@
+/*
+  SerialBackend.h - Where a simulated board's Serial bytes go
+
+  HardwareSerial buffers bytes in its RX/TX rings; a backend moves them
+  between the rings and the outside world. For polled backends the core
+  itself drains TX into write() and fills RX from read(). The in-process
+  channel backend is not polled: host threads use the rings directly
+  (see serialChannelRead() and serialChannelWrite()).
+
+  Host builds only.
+*/
+
+#ifndef SerialBackend_h
+#define SerialBackend_h
+
+#if !defined(__AVR__)
+
+#include <stddef.h>
+#include <stdint.h>
+
+class SerialBackend {
+public:
+    virtual ~SerialBackend() {}
+
+    // True when the core should call write() and read() itself
+    virtual bool polled() const = 0;
+
+    // Takes bytes from two consecutive spans (the second may be empty);
+    // returns how many were accepted
+    virtual size_t write(const uint8_t *first, size_t first_size,
+                         const uint8_t *second, size_t second_size) = 0;
+
+    // Non-blocking: copies whatever input is pending, 0 if none
+    virtual size_t read(uint8_t *buffer, size_t size) = 0;
+
+    // Human-readable location, e.g. "stdio" or a file path
+    virtual const char *name() const = 0;
+};
+
+// Reads and writes a pair of file descriptors. in_fd may be -1 for an
+// output-only backend. Descriptors are closed on destruction when owned.
+class FdSerialBackend : public SerialBackend {
+public:
+    FdSerialBackend(int in_fd, int out_fd, bool owned, const char *name);
+    ~FdSerialBackend();
+
+    bool polled() const { return true; }
+    size_t write(const uint8_t *first, size_t first_size,
+                 const uint8_t *second, size_t second_size);
+    size_t read(uint8_t *buffer, size_t size);
+    const char *name() const { return _name; }
+
+protected:
+    int _in_fd;
+    int _out_fd;
+    bool _owned;
+    char _name[128];
+};
+
+// Pseudo-terminal: external programs (the IDE's Serial Monitor, screen,
+// pyserial, ...) open the slave side like a physical port. Output blocks
+// while a reader is attached and cannot keep up, and is dropped while
+// nobody has the slave open. link, if not NULL, is a symlink created to
+// the slave device and removed on destruction.
+class PtySerialBackend : public FdSerialBackend {
+public:
+    // Returns NULL if no pseudo-terminal can be allocated
+    static PtySerialBackend *open(const char *link);
+    ~PtySerialBackend();
+
+private:
+    PtySerialBackend(int master_fd, const char *path, const char *link);
+
+    char _link[128];
+};
+
+// In-process channel: the host side talks to the rings directly
+class ChannelSerialBackend : public SerialBackend {
+public:
+    bool polled() const { return false; }
+    size_t write(const uint8_t *, size_t, const uint8_t *, size_t) { return 0; }
+    size_t read(uint8_t *, size_t) { return 0; }
+    const char *name() const { return "channel"; }
+};
+
+// Builds the backend named by ARDUINO_SERIAL:
+//   stdio (default)   stdin/stdout
+//   file:<path>       output appended to <path>, no input
+//   pty               new pseudo-terminal, path announced on stderr
+//   pty:<link>        same, plus a symlink at <link>
+//   channel           in-process channel
+// Returns NULL if the backend cannot be opened.
+SerialBackend *serialBackendFromEnv(void);
+
+#endif
+
+#endif
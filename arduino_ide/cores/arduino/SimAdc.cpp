@@ -0,0 +1,512 @@
+/*
+  SimAdc.cpp - Analog inputs replayed from recorded or synthetic signals
+*/
+
+#include "Arduino.h"
+
+#if defined(__AVR__)
+
+bool adcAttachFile(uint8_t pin, const char *path, uint32_t rate_hz, bool loop, uint8_t column) {
+    (void)pin;
+    (void)path;
+    (void)rate_hz;
+    (void)loop;
+    (void)column;
+    return false;
+}
+
+void adcDetach(uint8_t pin) {
+    (void)pin;
+}
+
+bool adcAddConstant(uint8_t pin, double value) {
+    (void)pin;
+    (void)value;
+    return false;
+}
+
+bool adcAddSine(uint8_t pin, double amplitude, double frequency_hz, double phase) {
+    (void)pin;
+    (void)amplitude;
+    (void)frequency_hz;
+    (void)phase;
+    return false;
+}
+
+bool adcAddSquare(uint8_t pin, double amplitude, double frequency_hz, double duty) {
+    (void)pin;
+    (void)amplitude;
+    (void)frequency_hz;
+    (void)duty;
+    return false;
+}
+
+bool adcAddRamp(uint8_t pin, double amplitude, double frequency_hz) {
+    (void)pin;
+    (void)amplitude;
+    (void)frequency_hz;
+    return false;
+}
+
+bool adcAddNoise(uint8_t pin, double sigma, double rate_hz, uint32_t seed) {
+    (void)pin;
+    (void)sigma;
+    (void)rate_hz;
+    (void)seed;
+    return false;
+}
+
+bool adcAddPiecewise(uint8_t pin, const SimAdcPoint *points, size_t count, bool loop) {
+    (void)pin;
+    (void)points;
+    (void)count;
+    (void)loop;
+    return false;
+}
+
+void adcClearSignals(uint8_t pin) {
+    (void)pin;
+}
+
+bool adcConvertCsv(const char *csv_path, const char *raw_path, uint8_t column) {
+    (void)csv_path;
+    (void)raw_path;
+    (void)column;
+    return false;
+}
+
+int adcRead(uint8_t pin) {
+    (void)pin;
+    return 0;
+}
+
+void adcInit(void) {
+}
+
+void adcFree(SimAdc *adc) {
+    (void)adc;
+}
+
+#else
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "ADC sample files are mapped as little-endian int16"
+#endif
+
+// Default sample rate for $ARDUINO_ADC_Ax without "@rate"
+#define ADC_DEFAULT_RATE_HZ 1000
+
+// Accepts 0-5 as well as A0-A5; NUM_ANALOG_INPUTS if neither
+static uint8_t adcInput(uint8_t pin) {
+    if (pin >= A0) {
+        pin -= A0;
+    }
+    return pin < NUM_ANALOG_INPUTS ? pin : NUM_ANALOG_INPUTS;
+}
+
+static void unmapStream(SimAdcStream &stream) {
+    if (stream.mapping != NULL) {
+        munmap(stream.mapping, stream.mapping_size);
+    }
+    memset(&stream, 0, sizeof(stream));
+}
+
+static bool endsWithCsv(const char *path) {
+    size_t len = strlen(path);
+    return len >= 4 && strcasecmp(path + len - 4, ".csv") == 0;
+}
+
+bool adcConvertCsv(const char *csv_path, const char *raw_path, uint8_t column) {
+    FILE *in = fopen(csv_path, "r");
+    if (in == NULL) {
+        return false;
+    }
+    // Written under a temporary name and renamed, so other instances
+    // never map a half-written file
+    char tmp_path[4096];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", raw_path, (int)getpid());
+    FILE *out = fopen(tmp_path, "wb");
+    if (out == NULL) {
+        fclose(in);
+        return false;
+    }
+
+    // getline() grows the buffer, so a long row is never split in two
+    char *line = NULL;
+    size_t line_size = 0;
+    bool ok = true;
+    while (ok && getline(&line, &line_size, in) != -1) {
+        char *field = line;
+        for (uint8_t i = 0; i < column && field != NULL; ++i) {
+            field = strpbrk(field, ",;\t");
+            if (field != NULL) {
+                field++;
+            }
+        }
+        if (field == NULL) {
+            continue;
+        }
+        char *end;
+        double value = strtod(field, &end);
+        if (end == field) {
+            continue;
+        }
+        value = value < INT16_MIN ? INT16_MIN : value > INT16_MAX ? INT16_MAX : value;
+        int16_t sample = (int16_t)lround(value);
+        ok = fwrite(&sample, sizeof(sample), 1, out) == 1;
+    }
+    free(line);
+    fclose(in);
+    ok = fclose(out) == 0 && ok;
+    if (!ok || rename(tmp_path, raw_path) != 0) {
+        unlink(tmp_path);
+        return false;
+    }
+    return true;
+}
+
+// Path of the int16 data for path, converting a CSV file unless an
+// up-to-date conversion exists
+static bool rawPathFor(const char *path, uint8_t column, char *raw_path, size_t size) {
+    if (!endsWithCsv(path)) {
+        snprintf(raw_path, size, "%s", path);
+        return true;
+    }
+    if ((size_t)snprintf(raw_path, size, "%s.%u.i16", path, column) >= size) {
+        return false;
+    }
+    struct stat csv_stat;
+    struct stat raw_stat;
+    if (stat(path, &csv_stat) != 0) {
+        return false;
+    }
+    if (stat(raw_path, &raw_stat) == 0 && raw_stat.st_mtime >= csv_stat.st_mtime) {
+        return true;
+    }
+    return adcConvertCsv(path, raw_path, column);
+}
+
+static SimAdc *ensureAdc(void) {
+    SimContext *ctx = simContext();
+    if (ctx->adc == NULL) {
+        ctx->adc = (SimAdc *)calloc(1, sizeof(SimAdc));
+    }
+    return ctx->adc;
+}
+
+bool adcAttachFile(uint8_t pin, const char *path, uint32_t rate_hz, bool loop, uint8_t column) {
+    uint8_t input = adcInput(pin);
+    char raw_path[4096];
+    if (input == NUM_ANALOG_INPUTS || rate_hz == 0 || !rawPathFor(path, column, raw_path, sizeof(raw_path))) {
+        return false;
+    }
+    SimAdc *adc = ensureAdc();
+    if (adc == NULL) {
+        return false;
+    }
+
+    int fd = open(raw_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    void *mapping = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(int16_t)) {
+        mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    // Replays read forward: let the kernel read ahead
+    madvise(mapping, st.st_size, MADV_SEQUENTIAL);
+
+    SimAdcStream &stream = adc->input[input].stream;
+    unmapStream(stream);
+    stream.samples = (const int16_t *)mapping;
+    stream.count = st.st_size / sizeof(int16_t);
+    stream.start_us = clockMicros64();
+    stream.rate_hz = rate_hz;
+    // The largest shift that keeps the multiplier within 64 bits
+    stream.shift = (uint8_t)(64 + 19 - (32 - __builtin_clz(rate_hz)));
+    stream.multiplier = (uint64_t)((((unsigned __int128)rate_hz << stream.shift) + 999999) / 1000000);
+    unsigned __int128 exact_us = ((unsigned __int128)1 << stream.shift) / 1000000;
+    stream.exact_us = exact_us > UINT64_MAX ? UINT64_MAX : (uint64_t)exact_us;
+    stream.loop = loop;
+    stream.mapping = mapping;
+    stream.mapping_size = st.st_size;
+    return true;
+}
+
+void adcDetach(uint8_t pin) {
+    uint8_t input = adcInput(pin);
+    SimAdc *adc = simContext()->adc;
+    if (adc != NULL && input < NUM_ANALOG_INPUTS) {
+        unmapStream(adc->input[input].stream);
+    }
+}
+
+// Generated terms
+
+// Claims the next term of pin, NULL if there is none left
+static SimAdcSignal *addSignal(uint8_t pin, uint8_t shape) {
+    uint8_t input = adcInput(pin);
+    SimAdc *adc = input < NUM_ANALOG_INPUTS ? ensureAdc() : NULL;
+    if (adc == NULL || adc->input[input].signals == ADC_MAX_SIGNALS) {
+        return NULL;
+    }
+    SimAdcInput &in = adc->input[input];
+    SimAdcSignal *signal = &in.signal[in.signals++];
+    memset(signal, 0, sizeof(*signal));
+    signal->shape = shape;
+    signal->start_us = clockMicros64();
+    return signal;
+}
+
+static bool addPeriodic(uint8_t pin, uint8_t shape, double amplitude, double frequency_hz, double phase, double duty) {
+    if (!(frequency_hz > 0)) {
+        return false;
+    }
+    SimAdcSignal *signal = addSignal(pin, shape);
+    if (signal == NULL) {
+        return false;
+    }
+    signal->amplitude = amplitude;
+    signal->period_us = 1e6 / frequency_hz;
+    signal->phase = phase;
+    signal->duty = duty;
+    return true;
+}
+
+bool adcAddConstant(uint8_t pin, double value) {
+    SimAdcSignal *signal = addSignal(pin, ADC_CONSTANT);
+    if (signal == NULL) {
+        return false;
+    }
+    signal->amplitude = value;
+    return true;
+}
+
+bool adcAddSine(uint8_t pin, double amplitude, double frequency_hz, double phase) {
+    return addPeriodic(pin, ADC_SINE, amplitude, frequency_hz, phase, 0);
+}
+
+bool adcAddSquare(uint8_t pin, double amplitude, double frequency_hz, double duty) {
+    return addPeriodic(pin, ADC_SQUARE, amplitude, frequency_hz, 0, duty);
+}
+
+bool adcAddRamp(uint8_t pin, double amplitude, double frequency_hz) {
+    return addPeriodic(pin, ADC_RAMP, amplitude, frequency_hz, 0, 0);
+}
+
+bool adcAddNoise(uint8_t pin, double sigma, double rate_hz, uint32_t seed) {
+    if (!(rate_hz > 0)) {
+        return false;
+    }
+    SimAdcSignal *signal = addSignal(pin, ADC_NOISE);
+    if (signal == NULL) {
+        return false;
+    }
+    signal->amplitude = sigma;
+    signal->period_us = 1e6 / rate_hz;
+    signal->seed = seed;
+    return true;
+}
+
+bool adcAddPiecewise(uint8_t pin, const SimAdcPoint *points, size_t count, bool loop) {
+    if (points == NULL || count == 0) {
+        return false;
+    }
+    SimAdcSignal *signal = addSignal(pin, ADC_PIECEWISE);
+    if (signal == NULL) {
+        return false;
+    }
+    signal->points = points;
+    signal->count = count;
+    signal->loop = loop;
+    return true;
+}
+
+void adcClearSignals(uint8_t pin) {
+    uint8_t input = adcInput(pin);
+    SimAdc *adc = simContext()->adc;
+    if (adc != NULL && input < NUM_ANALOG_INPUTS) {
+        adc->input[input].signals = 0;
+    }
+}
+
+static uint64_t mixBits(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Standard normal value number index of stream seed: two uniforms hashed
+// from the pair, through Box-Muller
+static double gaussian(uint64_t seed, uint64_t index) {
+    uint64_t a = mixBits(seed * 0x9E3779B97F4A7C15ULL + index * 2 + 1);
+    uint64_t b = mixBits(a + 0x9E3779B97F4A7C15ULL);
+    double u1 = ((a >> 11) + 1) * (1.0 / 9007199254740992.0);   // (0, 1]
+    double u2 = (b >> 11) * (1.0 / 9007199254740992.0);         // [0, 1)
+    return sqrt(-2.0 * log(u1)) * cos(TWO_PI * u2);
+}
+
+static double piecewiseValue(SimAdcSignal &signal, uint64_t t) {
+    const SimAdcPoint *p = signal.points;
+    size_t last = signal.count - 1;
+    if (t >= p[last].time_us) {
+        if (!signal.loop || p[last].time_us == 0) {
+            return p[last].value;
+        }
+        t %= p[last].time_us;
+    }
+    if (t <= p[0].time_us) {
+        return p[0].value;
+    }
+    // Reads move forward in time, so the segment is usually the last one
+    // or close after it
+    size_t i = signal.cursor;
+    if (i >= last || p[i].time_us > t) {
+        i = 0;
+    }
+    while (p[i + 1].time_us <= t) {
+        i++;
+    }
+    signal.cursor = i;
+    double fraction = (double)(t - p[i].time_us) / (p[i + 1].time_us - p[i].time_us);
+    return p[i].value + (p[i + 1].value - p[i].value) * fraction;
+}
+
+static double signalValue(SimAdcSignal &signal, uint64_t now) {
+    uint64_t elapsed = now - signal.start_us;
+    if (signal.shape == ADC_CONSTANT) {
+        return signal.amplitude;
+    }
+    if (signal.shape == ADC_NOISE) {
+        return signal.amplitude * gaussian(signal.seed, (uint64_t)(elapsed / signal.period_us));
+    }
+    if (signal.shape == ADC_PIECEWISE) {
+        return piecewiseValue(signal, elapsed);
+    }
+    double cycles = elapsed / signal.period_us + signal.phase;
+    double position = cycles - floor(cycles);
+    switch (signal.shape) {
+    case ADC_SINE:
+        return signal.amplitude * sin(TWO_PI * position);
+    case ADC_SQUARE:
+        return position < signal.duty ? signal.amplitude : -signal.amplitude;
+    case ADC_RAMP:
+        return signal.amplitude * (2 * position - 1);
+    }
+    return 0;
+}
+
+// elapsed * rate_hz / 10^6 rounded down. The multiplier is
+// 2^shift * rate_hz / 10^6 rounded up, so the product overshoots the exact
+// quotient by less than elapsed / 2^shift; below exact_us that is under
+// 1 / 10^6, too little to reach the next index.
+static int streamValue(const SimAdcStream &stream, uint64_t now) {
+    uint64_t elapsed = now - stream.start_us;
+    uint64_t index = elapsed < stream.exact_us
+        ? (uint64_t)(((unsigned __int128)elapsed * stream.multiplier) >> stream.shift)
+        : (uint64_t)((unsigned __int128)elapsed * stream.rate_hz / 1000000);
+    if (index >= stream.count) {
+        index = stream.loop ? index % stream.count : stream.count - 1;
+    }
+    return stream.samples[index];
+}
+
+int adcRead(uint8_t pin) {
+    uint8_t input = adcInput(pin);
+    SimAdc *adc = simContext()->adc;
+    if (adc == NULL || input == NUM_ANALOG_INPUTS) {
+        return 0;
+    }
+    SimAdcInput &in = adc->input[input];
+    uint64_t now = clockMicros64();
+    long value = in.stream.samples != NULL ? streamValue(in.stream, now) : 0;
+    if (in.signals > 0) {
+        double sum = value;
+        for (uint8_t i = 0; i < in.signals; ++i) {
+            sum += signalValue(in.signal[i], now);
+        }
+        // NaN reads as 0
+        sum = sum > 0 ? (sum < ADC_MAX ? sum : ADC_MAX) : 0;
+        value = lround(sum);
+    }
+    return value < 0 ? 0 : value > ADC_MAX ? ADC_MAX : (int)value;
+}
+
+// True for a non-empty run of decimal digits
+static bool allDigits(const char *text) {
+    if (*text == '\0') {
+        return false;
+    }
+    for (; *text != '\0'; ++text) {
+        if (*text < '0' || *text > '9') {
+            return false;
+        }
+    }
+    return true;
+}
+
+void adcInit(void) {
+    char name[] = "ARDUINO_ADC_A0";
+    for (uint8_t input = 0; input < NUM_ANALOG_INPUTS; ++input) {
+        name[sizeof(name) - 2] = (char)('0' + input);
+        const char *spec = getenv(name);
+        if (spec == NULL || *spec == '\0') {
+            continue;
+        }
+        char path[4096];
+        snprintf(path, sizeof(path), "%s", spec);
+        uint32_t rate_hz = ADC_DEFAULT_RATE_HZ;
+        bool loop = false;
+        uint8_t column = 0;
+
+        // Suffixes are taken off the end while they parse, so '@' and ','
+        // elsewhere in the file name are kept: ",loop", ",column=N", then
+        // "@rate"
+        for (;;) {
+            char *option = strrchr(path, ',');
+            if (option == NULL) {
+                break;
+            }
+            if (strcmp(option + 1, "loop") == 0) {
+                loop = true;
+            } else if (strncmp(option + 1, "column=", 7) == 0 && allDigits(option + 8)) {
+                column = (uint8_t)atoi(option + 8);
+            } else {
+                break;
+            }
+            *option = '\0';
+        }
+        char *rate = strrchr(path, '@');
+        if (rate != NULL && allDigits(rate + 1)) {
+            *rate = '\0';
+            rate_hz = (uint32_t)strtoul(rate + 1, NULL, 10);
+        }
+        if (!adcAttachFile(input, path, rate_hz, loop, column)) {
+            fprintf(stderr, "ADC: cannot replay %s=%s\n", name, spec);
+        }
+    }
+}
+
+void adcFree(SimAdc *adc) {
+    if (adc == NULL) {
+        return;
+    }
+    for (uint8_t input = 0; input < NUM_ANALOG_INPUTS; ++input) {
+        unmapStream(adc->input[input].stream);
+    }
+    free(adc);
+}
+
+#endif
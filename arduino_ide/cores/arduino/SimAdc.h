@@ -0,0 +1,127 @@
+/*
+  SimAdc.h - Analog inputs replayed from recorded or synthetic signals
+
+  Each analog input (A0-A5) can be fed from a capture: a file of raw
+  little-endian int16 ADC counts, memory-mapped, or one column of a CSV
+  file, converted once into such a file next to it ("<path>.<column>.i16")
+  and mapped from then on. Sample i applies from start + i / rate on the
+  virtual clock, so analogRead() costs one multiply and one load however
+  long the capture is, and a replay runs as fast as the scheduler moves
+  time. Past the last sample the stream holds it, or starts over when
+  looping.
+
+  On top of the stream (or alone), up to ADC_MAX_SIGNALS generated terms
+  are summed: constant, sine, square, ramp, Gaussian noise and
+  piecewise-linear. They are evaluated at the time of the read, never
+  buffered, so a run of any length uses the same memory; noise is a hash
+  of the sample index, so reading twice at one instant gives one value.
+  Periodic terms swing between -amplitude and +amplitude around 0; add
+  a constant for the mid-level.
+
+  The sum is rounded and clamped to 0..1023. Inputs with neither stream
+  nor terms read 0.
+
+  Host builds only; on AVR attaching always fails.
+*/
+
+#ifndef SimAdc_h
+#define SimAdc_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include "pins_arduino.h"
+
+#define ADC_MAX 1023
+
+struct SimAdcStream {
+    const int16_t *samples;     // NULL when the input is not fed
+    size_t count;
+    uint64_t start_us;          // virtual time of samples[0]
+    uint32_t rate_hz;
+    // Sample index = (elapsed_us * multiplier) >> shift while elapsed_us
+    // is below exact_us, see streamValue()
+    uint64_t multiplier;
+    uint64_t exact_us;
+    uint8_t shift;
+    bool loop;
+    void *mapping;
+    size_t mapping_size;
+};
+
+// Generated terms per input
+#define ADC_MAX_SIGNALS 4
+
+#define ADC_CONSTANT    0
+#define ADC_SINE        1
+#define ADC_SQUARE      2
+#define ADC_RAMP        3
+#define ADC_NOISE       4
+#define ADC_PIECEWISE   5
+
+// A corner of a piecewise-linear signal, time_us after the signal starts
+struct SimAdcPoint {
+    uint32_t time_us;
+    float value;
+};
+
+struct SimAdcSignal {
+    uint8_t shape;
+    bool loop;                  // PIECEWISE: repeat after the last point
+    uint64_t start_us;
+    double amplitude;           // NOISE: standard deviation
+    double period_us;           // NOISE: time each value holds
+    double phase;               // SINE, SQUARE, RAMP: fraction of a period
+    double duty;                // SQUARE: fraction of the period high
+    uint64_t seed;              // NOISE
+    const SimAdcPoint *points;  // PIECEWISE, owned by the caller
+    size_t count;
+    size_t cursor;              // segment of the last read
+};
+
+struct SimAdcInput {
+    SimAdcStream stream;
+    SimAdcSignal signal[ADC_MAX_SIGNALS];
+    uint8_t signals;
+};
+
+struct SimAdc {
+    SimAdcInput input[NUM_ANALOG_INPUTS];
+};
+
+// Feeds analog input pin (0-5 or A0-A5) from path at rate_hz, starting
+// now; column selects the CSV column (0 = first). Returns false if the
+// file cannot be mapped or converted, or holds no samples.
+bool adcAttachFile(uint8_t pin, const char *path, uint32_t rate_hz, bool loop = false, uint8_t column = 0);
+
+// Stops the stream feeding pin; its terms stay
+void adcDetach(uint8_t pin);
+
+// Add a term to analog input pin, starting now. Each returns false if
+// the pin already has ADC_MAX_SIGNALS terms.
+bool adcAddConstant(uint8_t pin, double value);
+bool adcAddSine(uint8_t pin, double amplitude, double frequency_hz, double phase = 0);
+bool adcAddSquare(uint8_t pin, double amplitude, double frequency_hz, double duty = 0.5);
+bool adcAddRamp(uint8_t pin, double amplitude, double frequency_hz);
+// A new value is drawn rate_hz times per second
+bool adcAddNoise(uint8_t pin, double sigma, double rate_hz, uint32_t seed = 1);
+// points must stay valid while the term is attached and be in time order
+bool adcAddPiecewise(uint8_t pin, const SimAdcPoint *points, size_t count, bool loop = false);
+
+// Removes every term of pin
+void adcClearSignals(uint8_t pin);
+
+// Writes column (0 = first) of every numeric CSV row to raw_path as
+// int16 samples. Rows that do not parse, such as a header, are skipped.
+bool adcConvertCsv(const char *csv_path, const char *raw_path, uint8_t column = 0);
+
+// The current count of analog input pin, as analogRead() returns it
+int adcRead(uint8_t pin);
+
+// Attaches the streams named by $ARDUINO_ADC_A0 .. $ARDUINO_ADC_A5,
+// "path[@rate_hz][,loop][,column=N]", called by main()
+void adcInit(void);
+
+// Unmaps every stream of adc and frees it
+void adcFree(SimAdc *adc);
+
+#endif
@@ -0,0 +1,117 @@
+/*
+  SimClock.cpp - Monotonic clock behind millis()/micros()
+*/
+
+#include "Arduino.h"
+
+#if !defined(__AVR__)
+#include <errno.h>
+#include <time.h>
+#endif
+
+#if !defined(__AVR__)
+static uint64_t monotonicNanos(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+uint64_t clockRealtimeMicros(void) {
+#if defined(__AVR__)
+    return simContext()->clock.now_us;
+#else
+    return (monotonicNanos() - simContext()->clock.epoch_ns) / 1000;
+#endif
+}
+
+uint64_t clockHostNanos(void) {
+#if defined(__AVR__)
+    return simContext()->clock.now_us * 1000;
+#else
+    return monotonicNanos();
+#endif
+}
+
+void clockSetMode(uint8_t mode) {
+#if defined(__AVR__)
+    (void)mode;
+#else
+    SimClock &clk = simContext()->clock;
+    if (mode == clk.mode) {
+        return;
+    }
+    if (mode == CLOCK_MODE_VIRTUAL) {
+        __atomic_store_n(&clk.now_us, clockRealtimeMicros(), __ATOMIC_RELAXED);
+    } else {
+        // Re-anchor the epoch so real time continues from the virtual time
+        clk.epoch_ns = monotonicNanos() - clk.now_us * 1000;
+    }
+    clk.mode = mode;
+#endif
+}
+
+uint8_t clockGetMode(void) {
+    return simContext()->clock.mode;
+}
+
+void clockAdvance(uint64_t us) {
+    SimClock &clk = simContext()->clock;
+    if (clk.mode != CLOCK_MODE_VIRTUAL) {
+        return;
+    }
+    __atomic_fetch_add(&clk.now_us, us, __ATOMIC_RELAXED);
+}
+
+void clockSetTime(uint64_t us) {
+    SimClock &clk = simContext()->clock;
+    if (clk.mode != CLOCK_MODE_VIRTUAL || us < clk.now_us) {
+        return;
+    }
+    __atomic_store_n(&clk.now_us, us, __ATOMIC_RELAXED);
+}
+
+void clockSleepUntil(uint64_t deadline_us) {
+    SimClock &clk = simContext()->clock;
+    if (clk.mode == CLOCK_MODE_VIRTUAL) {
+        clockSetTime(deadline_us);
+        return;
+    }
+#if !defined(__AVR__)
+    // Absolute deadlines keep repeated delays from accumulating drift
+    if (deadline_us > clockRealtimeMicros() + CLOCK_SPIN_THRESHOLD_US) {
+        uint64_t wake_ns = clk.epoch_ns + (deadline_us - CLOCK_SPIN_THRESHOLD_US) * 1000;
+        struct timespec ts;
+        ts.tv_sec = (time_t)(wake_ns / 1000000000ULL);
+        ts.tv_nsec = (long)(wake_ns % 1000000000ULL);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+        }
+    }
+    while (clockRealtimeMicros() < deadline_us) {
+    }
+#endif
+}
+
+void clockReset(uint8_t mode) {
+    SimClock &clk = simContext()->clock;
+#if defined(__AVR__)
+    (void)mode;
+    clk.mode = CLOCK_MODE_VIRTUAL;
+#else
+    clk.epoch_ns = monotonicNanos();
+    clk.mode = mode;
+#endif
+    clk.now_us = 0;
+}
+
+void clockInit(void) {
+    const char *mode = NULL;
+#if !defined(__AVR__)
+    mode = getenv("ARDUINO_CLOCK");
+#endif
+    if (mode != NULL && strcmp(mode, "virtual") == 0) {
+        clockReset(CLOCK_MODE_VIRTUAL);
+    } else {
+        clockReset(CLOCK_MODE_REALTIME);
+    }
+}
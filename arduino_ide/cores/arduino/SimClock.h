@@ -0,0 +1,59 @@
+/*
+  SimClock.h - Monotonic clock behind millis()/micros()
+
+  Two modes are available:
+    CLOCK_MODE_REALTIME  time follows the host's CLOCK_MONOTONIC
+    CLOCK_MODE_VIRTUAL   time only moves when the simulator advances it
+
+  Reading the clock never enters the kernel: virtual time is a single
+  load, and real time goes through the vDSO clock_gettime().
+  AVR builds have no host clock and always run in virtual mode.
+*/
+
+#ifndef SimClock_h
+#define SimClock_h
+
+#include <stdint.h>
+
+#define CLOCK_MODE_REALTIME 0
+#define CLOCK_MODE_VIRTUAL  1
+
+struct SimClock {
+    uint64_t now_us;    // virtual time, valid in CLOCK_MODE_VIRTUAL
+    uint64_t epoch_ns;  // CLOCK_MONOTONIC reading that maps to micros() == 0
+    uint8_t mode;
+};
+
+// Reads CLOCK_MONOTONIC relative to the clock's epoch
+uint64_t clockRealtimeMicros(void);
+
+// CLOCK_MONOTONIC in nanoseconds whatever the mode, for timing the
+// simulator itself; AVR builds return the virtual time
+uint64_t clockHostNanos(void);
+
+// Selects the clock mode; the current time carries over so micros()
+// never jumps backwards across a switch
+void clockSetMode(uint8_t mode);
+uint8_t clockGetMode(void);
+
+// Virtual mode only: moves time forward / to an absolute point.
+// Requests to move backwards are ignored.
+void clockAdvance(uint64_t us);
+void clockSetTime(uint64_t us);
+
+// Blocks until micros() reaches deadline_us. Virtual mode jumps straight
+// to the deadline; real-time mode sleeps and only spins for the final
+// CLOCK_SPIN_THRESHOLD_US microseconds.
+#define CLOCK_SPIN_THRESHOLD_US 50
+void clockSleepUntil(uint64_t deadline_us);
+
+// Restarts the current instance's clock at zero in the given mode
+void clockReset(uint8_t mode);
+
+// Configures the clock from ARDUINO_CLOCK=realtime|virtual, called by main()
+void clockInit(void);
+
+// Current time of the running instance; defined in SimContext.h
+inline uint64_t clockMicros64(void);
+
+#endif
@@ -0,0 +1,72 @@
+/*
+  SimContext.cpp - Per-instance state of a simulated board
+*/
+
+#include "Arduino.h"
+
+SimContext simDefaultContext = {
+    0,
+    { 0, 0, CLOCK_MODE_VIRTUAL },
+    { NULL, 0, 0, 0, 0, 0, 0, 1, false },
+    {},
+    {},
+    NULL,
+    NULL,
+    NULL,
+    SIM_RANDOM_DEFAULT,
+    NULL,
+    NULL,
+    false,
+    setup,
+    loop,
+    NULL
+};
+
+#if !defined(__AVR__)
+__thread SimContext *simCurrentContext = &simDefaultContext;
+#endif
+
+SimContext *simSetContext(SimContext *ctx) {
+    SimContext *previous = simContext();
+#if !defined(__AVR__)
+    simCurrentContext = ctx;
+#else
+    (void)ctx;
+#endif
+    return previous;
+}
+
+void simContextInit(SimContext *ctx, uint32_t id) {
+    const SimScheduler &parent = simContext()->scheduler;
+
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->id = id;
+    simRandomSeed(ctx->random, 1, id);
+    ctx->setup = setup;
+    ctx->loop = loop;
+    ctx->scheduler.time_limit_us = parent.time_limit_us;
+    ctx->scheduler.loop_limit = parent.loop_limit;
+    ctx->scheduler.loop_period_us = parent.loop_period_us;
+
+    SimContext *previous = simSetContext(ctx);
+    clockReset(CLOCK_MODE_VIRTUAL);
+    simSetContext(previous);
+}
+
+void simContextFree(SimContext *ctx) {
+    serialFreePort(ctx->serial);
+    ctx->serial = NULL;
+    adcFree(ctx->adc);
+    ctx->adc = NULL;
+    irqFree(ctx->irq);
+    ctx->irq = NULL;
+    free(ctx->scheduler.heap);
+    ctx->scheduler.heap = NULL;
+    ctx->scheduler.count = 0;
+    ctx->scheduler.capacity = 0;
+}
+
+void simContextBegin(void) {
+    simContext()->setup();
+    schedulerStart();
+}
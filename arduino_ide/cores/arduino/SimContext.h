@@ -0,0 +1,81 @@
+/*
+  SimContext.h - Per-instance state of a simulated board
+
+  Everything the core would normally keep in globals (clock, event queue,
+  pin registers, timers, PRNG state, ...) lives in a SimContext so that several
+  independent sketch instances can share one host process. Each thread runs one
+  instance at a time; simSetContext() selects it. Code that never touches
+  contexts runs against simDefaultContext, which main() sets up.
+*/
+
+#ifndef SimContext_h
+#define SimContext_h
+
+#include <stdint.h>
+#include "SimClock.h"
+#include "SimScheduler.h"
+#include "SimPins.h"
+#include "SimPwm.h"
+#include "SimRandom.h"
+
+struct SerialPort;
+struct SimAdc;
+struct SimIrq;
+class StringAllocator;
+class ArenaStringAllocator;
+
+struct SimContext {
+    uint32_t id;
+    SimClock clock;
+    SimScheduler scheduler;
+    SimPins pins;
+    SimPwm pwm;
+    SerialPort *serial;     // created by Serial.begin()
+    SimAdc *adc;            // created when a sample stream is attached
+    SimIrq *irq;            // created by attachInterrupt() or noInterrupts()
+    SimRandom random;
+    StringAllocator *string_allocator;          // for new Strings, NULL = heap
+    ArenaStringAllocator *string_loop_arena;    // replaces it inside loop()
+    bool in_loop;
+    void (*setup)(void);
+    void (*loop)(void);
+    void *user_data;
+};
+
+extern SimContext simDefaultContext;
+
+#if defined(__AVR__)
+inline SimContext *simContext(void) {
+    return &simDefaultContext;
+}
+#else
+extern __thread SimContext *simCurrentContext;
+
+inline SimContext *simContext(void) {
+    return simCurrentContext;
+}
+#endif
+
+// Makes ctx the instance the calling thread operates on; returns the
+// previous one so callers can restore it
+SimContext *simSetContext(SimContext *ctx);
+
+// Prepares a fresh instance running the sketch's setup()/loop() on a
+// virtual clock. Run budgets are inherited from the current context.
+void simContextInit(SimContext *ctx, uint32_t id);
+
+// Releases memory owned by the instance
+void simContextFree(SimContext *ctx);
+
+// Runs setup() for the current context and queues its first loop()
+void simContextBegin(void);
+
+inline uint64_t clockMicros64(void) {
+    SimClock &clk = simContext()->clock;
+    if (clk.mode == CLOCK_MODE_VIRTUAL) {
+        return __atomic_load_n(&clk.now_us, __ATOMIC_RELAXED);
+    }
+    return clockRealtimeMicros();
+}
+
+#endif
@@ -0,0 +1,148 @@
+/*
+  SimFleet.cpp - Many simulated boards in one host process
+*/
+
+#if !defined(__AVR__)
+
+// Standard library headers must come before Arduino.h and its macros
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "Arduino.h"
+#include "SimFleet.h"
+
+namespace {
+
+struct WorkQueue {
+    std::mutex lock;
+    std::deque<size_t> tasks;
+};
+
+}
+
+struct SimFleet {
+    std::vector<SimContext> instances;
+    std::vector<uint8_t> started;
+};
+
+SimFleet *fleetCreate(size_t count, void (*setup)(void), void (*loop)(void)) {
+    SimFleet *fleet = new (std::nothrow) SimFleet;
+    if (fleet == NULL) {
+        return NULL;
+    }
+    fleet->instances.resize(count);
+    fleet->started.assign(count, 0);
+    for (size_t i = 0; i < count; i++) {
+        SimContext *ctx = &fleet->instances[i];
+        simContextInit(ctx, (uint32_t)i);
+        ctx->setup = setup;
+        ctx->loop = loop;
+    }
+    return fleet;
+}
+
+size_t fleetSize(const SimFleet *fleet) {
+    return fleet->instances.size();
+}
+
+SimContext *fleetInstance(SimFleet *fleet, size_t index) {
+    return &fleet->instances[index];
+}
+
+static bool popOwn(WorkQueue &queue, size_t &task) {
+    std::lock_guard<std::mutex> guard(queue.lock);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    task = queue.tasks.back();
+    queue.tasks.pop_back();
+    return true;
+}
+
+static bool steal(std::vector<WorkQueue> &queues, size_t self, size_t &task) {
+    for (size_t n = 1; n < queues.size(); n++) {
+        WorkQueue &victim = queues[(self + n) % queues.size()];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+// Returns true while the instance still has work
+static bool runSlice(SimFleet *fleet, size_t index) {
+    SimContext *previous = simSetContext(&fleet->instances[index]);
+    if (!fleet->started[index]) {
+        fleet->started[index] = 1;
+        simContextBegin();
+    }
+    bool more = schedulerStep(FLEET_SLICE_EVENTS);
+    simSetContext(previous);
+    return more;
+}
+
+void fleetRun(SimFleet *fleet, unsigned threads) {
+    size_t count = fleet->instances.size();
+    if (count == 0) {
+        return;
+    }
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    if (threads == 0) {
+        threads = 1;
+    }
+    if (threads > count) {
+        threads = (unsigned)count;
+    }
+
+    std::vector<WorkQueue> queues(threads);
+    for (size_t i = 0; i < count; i++) {
+        queues[i % threads].tasks.push_back(i);
+    }
+    std::atomic<size_t> remaining(count);
+
+    auto worker = [&](size_t self) {
+        while (remaining.load(std::memory_order_acquire) > 0) {
+            size_t task;
+            if (!popOwn(queues[self], task) && !steal(queues, self, task)) {
+                std::this_thread::yield();
+                continue;
+            }
+            if (runSlice(fleet, task)) {
+                std::lock_guard<std::mutex> guard(queues[self].lock);
+                queues[self].tasks.push_back(task);
+            } else {
+                remaining.fetch_sub(1, std::memory_order_release);
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; t++) {
+        pool.emplace_back(worker, (size_t)t);
+    }
+    worker(0);
+    for (std::thread &thread : pool) {
+        thread.join();
+    }
+}
+
+void fleetDestroy(SimFleet *fleet) {
+    if (fleet == NULL) {
+        return;
+    }
+    for (SimContext &ctx : fleet->instances) {
+        simContextFree(&ctx);
+    }
+    delete fleet;
+}
+
+#endif
@@ -0,0 +1,42 @@
+/*
+  SimFleet.h - Many simulated boards in one host process
+
+  A fleet owns N SimContext instances and spreads them over a
+  work-stealing thread pool. Each instance runs the given setup()/loop()
+  pair on its own virtual clock, event queue and PRNG; work is handed out
+  in slices of scheduler events so long-running instances do not starve
+  the rest. Sketch globals are shared between instances, so device code
+  should keep per-board state behind simContext()->id or ->user_data.
+
+  Host builds only.
+*/
+
+#ifndef SimFleet_h
+#define SimFleet_h
+
+#if !defined(__AVR__)
+
+#include <stddef.h>
+#include "SimContext.h"
+
+// Scheduler events dispatched per instance before it goes back in the queue
+#define FLEET_SLICE_EVENTS 256
+
+struct SimFleet;
+
+// Creates count instances numbered 0..count-1. Run budgets are inherited
+// from the calling context. Returns NULL when out of memory.
+SimFleet *fleetCreate(size_t count, void (*setup)(void), void (*loop)(void));
+
+size_t fleetSize(const SimFleet *fleet);
+SimContext *fleetInstance(SimFleet *fleet, size_t index);
+
+// Runs every instance to the end of its budget on the given number of
+// threads (0 = one per hardware thread) and returns when all are done
+void fleetRun(SimFleet *fleet, unsigned threads);
+
+void fleetDestroy(SimFleet *fleet);
+
+#endif
+
+#endif
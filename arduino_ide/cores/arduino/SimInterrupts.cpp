@@ -0,0 +1,186 @@
+/*
+  SimInterrupts.cpp - External interrupt controller
+*/
+
+#include "Arduino.h"
+#include "RingBuffer.h"
+
+// Pin of each external interrupt
+static const uint8_t irqPins[EXTERNAL_NUM_INTERRUPTS] = { 2, 3 };
+
+struct IrqTrigger {
+    uint64_t time_us;
+    uint64_t host_ns;
+    uint8_t number;
+};
+
+struct SimIrq {
+    // Filled by the pin layer, drained by irqService()
+    SpscRing<IrqTrigger> queue;
+    void (*handler[EXTERNAL_NUM_INTERRUPTS])(void);
+    uint8_t mode[EXTERNAL_NUM_INTERRUPTS];
+    bool enabled;
+    bool servicing;
+    SimIrqStats stats;
+};
+
+static SimIrq *irqController(void) {
+    SimContext *ctx = simContext();
+    if (ctx->irq == NULL) {
+        SimIrq *irq = new SimIrq;
+        if (!irq->queue.allocate(IRQ_QUEUE_CAPACITY)) {
+            delete irq;
+            return NULL;
+        }
+        memset(irq->handler, 0, sizeof(irq->handler));
+        memset(irq->mode, 0, sizeof(irq->mode));
+        irq->enabled = true;
+        irq->servicing = false;
+        memset(&irq->stats, 0, sizeof(irq->stats));
+        ctx->irq = irq;
+    }
+    return ctx->irq;
+}
+
+// Arms or disarms edge detection on the interrupt's pin
+static void irqArm(uint8_t number, bool armed) {
+    SimPins &pins = simContext()->pins;
+    uint8_t port = digitalPinToPort(irqPins[number]);
+    uint8_t mask = digitalPinToBitMask(irqPins[number]);
+    if (armed) {
+        pins.irq[port] |= mask;
+    } else {
+        pins.irq[port] &= ~mask;
+    }
+}
+
+void irqAttach(uint8_t number, void (*handler)(void), uint8_t mode) {
+    if (number >= EXTERNAL_NUM_INTERRUPTS || handler == NULL) {
+        return;
+    }
+    SimIrq *irq = irqController();
+    if (irq == NULL) {
+        return;
+    }
+    irq->handler[number] = handler;
+    irq->mode[number] = mode;
+    irqArm(number, mode != LOW);
+}
+
+void irqDetach(uint8_t number) {
+    SimIrq *irq = simContext()->irq;
+    if (number >= EXTERNAL_NUM_INTERRUPTS || irq == NULL) {
+        return;
+    }
+    // Queued triggers of this interrupt are dropped when serviced
+    irq->handler[number] = NULL;
+    irqArm(number, false);
+}
+
+void irqEnable(bool enabled) {
+    SimIrq *irq = simContext()->irq;
+    if (irq == NULL) {
+        if (enabled) {
+            return;
+        }
+        irq = irqController();
+        if (irq == NULL) {
+            return;
+        }
+    }
+    irq->enabled = enabled;
+    if (enabled) {
+        irqService();
+    }
+}
+
+void irqPinChange(uint8_t port, uint8_t changed) {
+    SimContext *ctx = simContext();
+    SimIrq *irq = ctx->irq;
+    uint8_t level = ctx->pins.pin[port];
+    for (uint8_t number = 0; number < EXTERNAL_NUM_INTERRUPTS; number++) {
+        uint8_t pin = irqPins[number];
+        uint8_t mask = digitalPinToBitMask(pin);
+        if (digitalPinToPort(pin) != port || !(changed & mask)) {
+            continue;
+        }
+        uint8_t mode = irq->mode[number];
+        bool high = (level & mask) != 0;
+        if ((mode == RISING && !high) || (mode == FALLING && high)) {
+            continue;
+        }
+
+        IrqTrigger trigger;
+        trigger.time_us = clockMicros64();
+        trigger.host_ns = clockHostNanos();
+        trigger.number = number;
+        if (!irq->queue.push(trigger)) {
+            irq->stats.lost++;
+        }
+    }
+}
+
+static void irqRun(SimIrq *irq, void (*handler)(void), uint64_t time_us, uint64_t host_ns) {
+    SimIrqStats &stats = irq->stats;
+    uint64_t latency_ns = clockHostNanos() - host_ns;
+    uint64_t delay_us = clockMicros64() - time_us;
+    stats.serviced++;
+    stats.latency_ns_total += latency_ns;
+    if (latency_ns > stats.latency_ns_max) {
+        stats.latency_ns_max = latency_ns;
+    }
+    if (delay_us > stats.delay_us_max) {
+        stats.delay_us_max = delay_us;
+    }
+    handler();
+}
+
+void irqService(void) {
+    SimContext *ctx = simContext();
+    SimIrq *irq = ctx->irq;
+    if (irq == NULL || !irq->enabled || irq->servicing) {
+        return;
+    }
+    irq->servicing = true;
+
+    IrqTrigger trigger;
+    while (irq->enabled && irq->queue.pop(trigger)) {
+        void (*handler)(void) = irq->handler[trigger.number];
+        if (handler != NULL) {
+            irqRun(irq, handler, trigger.time_us, trigger.host_ns);
+        }
+    }
+
+    // Level-triggered interrupts fire for as long as their pin is low
+    for (uint8_t number = 0; number < EXTERNAL_NUM_INTERRUPTS; number++) {
+        void (*handler)(void) = irq->handler[number];
+        uint8_t pin = irqPins[number];
+        if (handler != NULL && irq->mode[number] == LOW && irq->enabled &&
+            !(ctx->pins.pin[digitalPinToPort(pin)] & digitalPinToBitMask(pin))) {
+            irqRun(irq, handler, clockMicros64(), clockHostNanos());
+        }
+    }
+
+    irq->servicing = false;
+}
+
+SimIrqStats irqStats(void) {
+    SimIrq *irq = simContext()->irq;
+    if (irq == NULL) {
+        SimIrqStats none;
+        memset(&none, 0, sizeof(none));
+        return none;
+    }
+    return irq->stats;
+}
+
+void irqResetStats(void) {
+    SimIrq *irq = simContext()->irq;
+    if (irq != NULL) {
+        memset(&irq->stats, 0, sizeof(irq->stats));
+    }
+}
+
+void irqFree(SimIrq *irq) {
+    delete irq;
+}
@@ -0,0 +1,64 @@
+/*
+  SimInterrupts.h - External interrupt controller
+
+  The Uno has two external interrupts, INT0 on pin 2 and INT1 on pin 3
+  (digitalPinToInterrupt()). attachInterrupt() arms one for RISING,
+  FALLING or CHANGE; whenever such a pin's level changes, whatever
+  changed it (a sketch write, pinDrive(), a PWM edge), the pin layer
+  hands the change to the controller, which queues a trigger stamped
+  with the virtual and host time in a lock-free ring.
+
+  The scheduler services the queue after every event it dispatches and
+  when delay() starts, so handlers run between loop() iterations and at
+  each point where virtual time moves; a stimulus posted as an event is
+  serviced at its own instant. Handlers run one at a time and do not
+  nest: triggers raised inside one wait until it returns.
+  noInterrupts() holds the queue and interrupts() services it. Triggers
+  arriving while the queue is full are lost and counted, like edges a
+  busy chip misses.
+
+  A LOW interrupt is level-triggered: its handler runs at every service
+  point while the pin is low.
+
+  Latency is measured on the host from the pin change to the handler's
+  entry and reported by irqStats().
+*/
+
+#ifndef SimInterrupts_h
+#define SimInterrupts_h
+
+#include <stdint.h>
+#include "pins_arduino.h"
+
+// Triggers that can wait for service
+#define IRQ_QUEUE_CAPACITY 64
+
+struct SimIrq;
+
+struct SimIrqStats {
+    uint32_t serviced;          // handler runs, LOW ones included
+    uint32_t lost;              // triggers dropped on a full queue
+    uint64_t latency_ns_total;  // host time from pin change to handler
+    uint64_t latency_ns_max;
+    uint64_t delay_us_max;      // virtual time from pin change to handler
+};
+
+void irqAttach(uint8_t number, void (*handler)(void), uint8_t mode);
+void irqDetach(uint8_t number);
+
+// Enables or masks the current instance's interrupts; enabling services
+// what is pending
+void irqEnable(bool enabled);
+
+// Runs the handlers of pending triggers, called by the scheduler
+void irqService(void);
+
+// Latency and loss counters of the current instance; zero before any
+// interrupt is attached
+SimIrqStats irqStats(void);
+void irqResetStats(void);
+
+// Frees the controller of an instance
+void irqFree(SimIrq *irq);
+
+#endif
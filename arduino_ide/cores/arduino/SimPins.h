@@ -0,0 +1,93 @@
+/*
+  SimPins.h - Pin state store modelled on the AVR port registers
+
+  Each port keeps the three registers a sketch can see (PORTx, DDRx,
+  PINx) plus the level applied from outside by the simulator. Every pin
+  operation is a table lookup followed by bit operations on one port.
+
+  As on the chip, a running PWM output overrides the PORTx latch of its
+  pin while the pin is an output; the timer model (SimPwm.h) sets those
+  bits and their level. Pins with an armed edge interrupt are reported to
+  the interrupt controller (SimInterrupts.h) when their level changes.
+*/
+
+#ifndef SimPins_h
+#define SimPins_h
+
+#include <stdint.h>
+#include "pins_arduino.h"
+#include "SimVcd.h"
+
+// Interrupt controller side: armed bits of port changed (SimInterrupts.h)
+void irqPinChange(uint8_t port, uint8_t changed);
+
+// Timer side: stops the PWM outputs on the mask bits of port (SimPwm.h)
+void pwmStopPort(uint8_t port, uint8_t mask);
+
+struct SimPins {
+    uint8_t port[NUM_PORTS];    // PORTx: output latch, pull-up enable on inputs
+    uint8_t ddr[NUM_PORTS];     // DDRx: 1 = output
+    uint8_t pin[NUM_PORTS];     // PINx: level digitalRead() sees
+    uint8_t ext[NUM_PORTS];     // level applied by an external driver
+    uint8_t driven[NUM_PORTS];  // bits that have an external driver
+    uint8_t pwm[NUM_PORTS];     // bits driven by a timer output
+    uint8_t pwm_level[NUM_PORTS];   // current level of those outputs
+    uint8_t irq[NUM_PORTS];     // bits with an edge interrupt armed
+    SimVcd *vcd;                // transition recorder, NULL when off
+};
+
+// Recomputes PINx: outputs read back their latch (or their timer output),
+// driven inputs read the external level and undriven inputs read their
+// pull-up (floating = LOW)
+inline void simPinsRefresh(SimPins &pins, uint8_t port) {
+    uint8_t output = (pins.pwm_level[port] & pins.pwm[port]) | (pins.port[port] & ~pins.pwm[port]);
+    uint8_t input = (pins.ext[port] & pins.driven[port]) | (pins.port[port] & ~pins.driven[port]);
+    uint8_t level = (output & pins.ddr[port]) | (input & ~pins.ddr[port]);
+    uint8_t changed = level ^ pins.pin[port];
+    if (__builtin_expect(pins.vcd != NULL, 0) && changed != 0) {
+        vcdRecordPort(pins.vcd, port, level);
+    }
+    pins.pin[port] = level;
+    if (__builtin_expect((changed & pins.irq[port]) != 0, 0)) {
+        irqPinChange(port, changed & pins.irq[port]);
+    }
+}
+
+// A digital write ends PWM on the pins it touches. Called once the latch
+// holds the new level, so the output goes straight from the timer to it.
+inline void simPinsEndPwm(SimPins &pins, uint8_t port, uint8_t mask) {
+    if (__builtin_expect((pins.pwm[port] & mask) != 0, 0)) {
+        pwmStopPort(port, pins.pwm[port] & mask);
+    }
+}
+
+inline void simPinsSetMode(SimPins &pins, uint8_t port, uint8_t mask, uint8_t mode) {
+    if (mode == OUTPUT) {
+        pins.ddr[port] |= mask;
+    } else {
+        pins.ddr[port] &= ~mask;
+        if (mode == INPUT_PULLUP) {
+            pins.port[port] |= mask;
+        } else {
+            pins.port[port] &= ~mask;
+        }
+    }
+    simPinsRefresh(pins, port);
+}
+
+inline void simPinsWrite(SimPins &pins, uint8_t port, uint8_t mask, uint8_t val) {
+    uint8_t level = (uint8_t)-(uint8_t)(val != LOW);
+    pins.port[port] = (pins.port[port] & ~mask) | (level & mask);
+    simPinsRefresh(pins, port);
+    simPinsEndPwm(pins, port, mask);
+}
+
+inline int simPinsRead(const SimPins &pins, uint8_t port, uint8_t mask) {
+    return (pins.pin[port] & mask) ? HIGH : LOW;
+}
+
+// Simulator side: applies / removes an external level on a pin
+void pinDrive(uint8_t pin, uint8_t level);
+void pinRelease(uint8_t pin);
+
+#endif
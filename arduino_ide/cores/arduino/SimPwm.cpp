@@ -0,0 +1,203 @@
+/*
+  SimPwm.cpp - Timer model behind analogWrite()
+*/
+
+#include "Arduino.h"
+
+// Pin of each timer output, TIMER0A first
+static const uint8_t pwmPins[NUM_TIMER_OUTPUTS] = { 6, 5, 9, 10, 11, 3 };
+
+// One cycle of an output: high from rise_us to fall_us, wrapping around
+// the period for phase-correct outputs
+struct PwmShape {
+    uint32_t period_us;
+    uint32_t rise_us;
+    uint32_t fall_us;
+};
+
+static PwmShape pwmShape(uint8_t index, uint8_t value) {
+    PwmShape shape;
+    if (index < TIMER0B) {
+        // Fast PWM: set at BOTTOM, cleared on the tick after the compare match
+        shape.period_us = 256 * PWM_TICK_US;
+        shape.rise_us = 0;
+        shape.fall_us = (value + 1) * PWM_TICK_US;
+    } else {
+        // Phase-correct: high while the counter is below the compare value,
+        // on the way down and on the way back up
+        shape.period_us = 510 * PWM_TICK_US;
+        shape.rise_us = shape.period_us - value * PWM_TICK_US;
+        shape.fall_us = value * PWM_TICK_US;
+    }
+    return shape;
+}
+
+static bool shapeHigh(const PwmShape &shape, uint64_t time_us) {
+    uint32_t phase = (uint32_t)(time_us % shape.period_us);
+    if (shape.rise_us < shape.fall_us) {
+        return phase >= shape.rise_us && phase < shape.fall_us;
+    }
+    return phase >= shape.rise_us || phase < shape.fall_us;
+}
+
+static uint64_t shapeNextEdge(const PwmShape &shape, uint64_t time_us) {
+    uint32_t phase = (uint32_t)(time_us % shape.period_us);
+    uint64_t start = time_us - phase;
+    uint32_t first = shape.rise_us < shape.fall_us ? shape.rise_us : shape.fall_us;
+    uint32_t second = shape.rise_us < shape.fall_us ? shape.fall_us : shape.rise_us;
+    if (phase < first) {
+        return start + first;
+    }
+    if (phase < second) {
+        return start + second;
+    }
+    return start + shape.period_us + first;
+}
+
+// Index of pin's timer output, or -1
+static int pwmIndex(uint8_t pin) {
+    return (int)digitalPinToTimer(pin) - 1;
+}
+
+static void pwmRecordAverage(uint8_t pin) {
+    SimVcd *vcd = simContext()->pins.vcd;
+    if (vcd != NULL) {
+        vcdRecordAverage(vcd, pin, pwmAverage(pin));
+    }
+}
+
+// Sets the timer's level on the pin from the output's waveform at now
+static void pwmApply(uint8_t index, uint64_t now) {
+    uint8_t pin = pwmPins[index];
+    uint8_t port = digitalPinToPort(pin);
+    uint8_t mask = digitalPinToBitMask(pin);
+    SimPins &pins = simContext()->pins;
+    PwmShape shape = pwmShape(index, simContext()->pwm.output[index].value);
+    uint8_t level = (uint8_t)-(uint8_t)shapeHigh(shape, now);
+    pins.pwm_level[port] = (pins.pwm_level[port] & ~mask) | (level & mask);
+    simPinsRefresh(pins, port);
+}
+
+// The event argument names the output and the generation it was queued for
+static void *pwmTag(uint8_t index, uint32_t generation) {
+    return (void *)(((uintptr_t)generation << 3) | index);
+}
+
+static void pwmEdge(void *arg) {
+    uint8_t index = (uint8_t)((uintptr_t)arg & 7);
+    SimPwmOutput &output = simContext()->pwm.output[index];
+    if (output.value == 0 || arg != pwmTag(index, output.generation)) {
+        return;
+    }
+    uint64_t now = clockMicros64();
+    pwmApply(index, now);
+    output.next_us = shapeNextEdge(pwmShape(index, output.value), now);
+    schedulerPost(output.next_us, SIM_EVENT_TIMER, pwmEdge, arg);
+}
+
+void pwmStart(uint8_t pin, uint8_t value) {
+    int index = pwmIndex(pin);
+    if (index < 0 || value == 0) {
+        return;
+    }
+    SimContext *ctx = simContext();
+    SimPwmOutput &output = ctx->pwm.output[index];
+    if (output.value == value) {
+        return;
+    }
+    bool running = output.value != 0;
+    output.value = value;
+    ctx->pins.pwm[digitalPinToPort(pin)] |= digitalPinToBitMask(pin);
+
+    uint64_t now = clockMicros64();
+    pwmApply(index, now);
+    // A queued edge that comes no earlier than the new waveform's next one
+    // can stay: the handler recomputes the level from the current value
+    uint64_t next = shapeNextEdge(pwmShape(index, value), now);
+    if (!running || next < output.next_us) {
+        output.generation++;
+        output.next_us = next;
+        schedulerPost(next, SIM_EVENT_TIMER, pwmEdge, pwmTag(index, output.generation));
+    }
+    pwmRecordAverage(pin);
+}
+
+void pwmStop(uint8_t pin) {
+    int index = pwmIndex(pin);
+    if (index < 0) {
+        return;
+    }
+    SimContext *ctx = simContext();
+    SimPwmOutput &output = ctx->pwm.output[index];
+    if (output.value == 0) {
+        return;
+    }
+    output.value = 0;
+    output.generation++;
+
+    uint8_t port = digitalPinToPort(pin);
+    ctx->pins.pwm[port] &= ~digitalPinToBitMask(pin);
+    simPinsRefresh(ctx->pins, port);
+    pwmRecordAverage(pin);
+}
+
+void pwmStopPort(uint8_t port, uint8_t mask) {
+    for (uint8_t index = 0; index < NUM_TIMER_OUTPUTS; index++) {
+        uint8_t pin = pwmPins[index];
+        if (digitalPinToPort(pin) == port && (digitalPinToBitMask(pin) & mask)) {
+            pwmStop(pin);
+        }
+    }
+}
+
+bool pwmRunning(uint8_t pin) {
+    return pwmValue(pin) != 0;
+}
+
+uint8_t pwmValue(uint8_t pin) {
+    int index = pwmIndex(pin);
+    return index < 0 ? 0 : simContext()->pwm.output[index].value;
+}
+
+uint32_t pwmPeriodMicros(uint8_t pin) {
+    uint8_t value = pwmValue(pin);
+    return value == 0 ? 0 : pwmShape(pwmIndex(pin), value).period_us;
+}
+
+uint32_t pwmHighMicros(uint8_t pin) {
+    uint8_t value = pwmValue(pin);
+    if (value == 0) {
+        return 0;
+    }
+    PwmShape shape = pwmShape(pwmIndex(pin), value);
+    return (shape.fall_us - shape.rise_us + shape.period_us) % shape.period_us;
+}
+
+float pwmFrequency(uint8_t pin) {
+    uint32_t period_us = pwmPeriodMicros(pin);
+    return period_us == 0 ? 0.0f : 1e6f / period_us;
+}
+
+float pwmAverage(uint8_t pin) {
+    uint32_t period_us = pwmPeriodMicros(pin);
+    if (period_us == 0) {
+        return (simContext()->pins.port[digitalPinToPort(pin)] & digitalPinToBitMask(pin)) ? 1.0f : 0.0f;
+    }
+    return (float)pwmHighMicros(pin) / period_us;
+}
+
+uint8_t pwmLevelAt(uint8_t pin, uint64_t time_us) {
+    uint8_t value = pwmValue(pin);
+    if (value == 0) {
+        return pwmAverage(pin) != 0.0f ? HIGH : LOW;
+    }
+    return shapeHigh(pwmShape(pwmIndex(pin), value), time_us) ? HIGH : LOW;
+}
+
+uint64_t pwmNextEdge(uint8_t pin, uint64_t time_us) {
+    uint8_t value = pwmValue(pin);
+    if (value == 0) {
+        return UINT64_MAX;
+    }
+    return shapeNextEdge(pwmShape(pwmIndex(pin), value), time_us);
+}
@@ -0,0 +1,79 @@
+/*
+  SimPwm.h - Timer model behind analogWrite()
+
+  analogWrite() on a PWM pin starts that pin's timer output, clocked the
+  way the Arduino core sets the timers up at boot (16 MHz / 64, one tick
+  every 4 us):
+
+    Timer0  pins 5, 6    fast PWM        1024 us period (976.6 Hz)
+    Timer1  pins 9, 10   phase-correct   2040 us period (490.2 Hz)
+    Timer2  pins 3, 11   phase-correct   2040 us period (490.2 Hz)
+
+  As on the chip, a fast PWM output is high for value + 1 of 256 ticks
+  from the start of each period, and a phase-correct one for 2 * value of
+  510 ticks centred on it, so outputs of one timer share their period
+  boundaries. Every timer starts at time 0 of the instance's clock.
+
+  The waveform is known in closed form: its averaged level, frequency,
+  level at any instant and next edge cost a few arithmetic operations, so
+  a power estimate or circuit model can integrate over a run without
+  sampling it. While an output runs, the scheduler also moves the pin
+  through each edge, so digitalRead() and the VCD recorder see the real
+  waveform; the recorder additionally traces each PWM pin's averaged
+  level as a real variable.
+
+  A new value takes effect at once instead of at the next period
+  boundary. analogWrite() of 0 or 255 and every digital write to the pin
+  (digitalWrite(), digitalWriteFast(), port and pin group writes) stop
+  the output.
+*/
+
+#ifndef SimPwm_h
+#define SimPwm_h
+
+#include <stdint.h>
+#include "pins_arduino.h"
+
+#define PWM_TICK_US 4
+
+struct SimPwmOutput {
+    uint64_t next_us;       // time of the queued edge event
+    uint32_t generation;    // advanced when that event is superseded
+    uint8_t value;          // analogWrite() value, 0 when stopped
+};
+
+struct SimPwm {
+    SimPwmOutput output[NUM_TIMER_OUTPUTS];   // indexed by timer output - 1
+};
+
+// Starts or retunes the timer output of pin with 0 < value < 255; pins
+// without one are ignored. analogWrite() has already made pin an output.
+void pwmStart(uint8_t pin, uint8_t value);
+
+// Stops the timer output of pin; its PORTx latch drives it again
+void pwmStop(uint8_t pin);
+
+bool pwmRunning(uint8_t pin);
+
+// analogWrite() value of a running output, 0 otherwise
+uint8_t pwmValue(uint8_t pin);
+
+// Period and high time of one cycle, 0 when not running
+uint32_t pwmPeriodMicros(uint8_t pin);
+uint32_t pwmHighMicros(uint8_t pin);
+
+// Output frequency in Hz, 0 when not running
+float pwmFrequency(uint8_t pin);
+
+// Fraction of time the output is high: the duty cycle while PWM runs,
+// otherwise the output latch as 0 or 1. Multiply by the supply voltage
+// for the averaged analog level.
+float pwmAverage(uint8_t pin);
+
+// Output level (HIGH or LOW) at time_us on the instance's clock, and the
+// time of the first edge after it (UINT64_MAX if the level is constant),
+// assuming the current setting holds
+uint8_t pwmLevelAt(uint8_t pin, uint64_t time_us);
+uint64_t pwmNextEdge(uint8_t pin, uint64_t time_us);
+
+#endif
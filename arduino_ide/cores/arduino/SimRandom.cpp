@@ -0,0 +1,36 @@
+/*
+  SimRandom.cpp - Pseudo-random generator behind random()/randomSeed()
+*/
+
+#include "Arduino.h"
+
+static uint64_t splitMix64(uint64_t &x) {
+    uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+void simRandomSeed(SimRandom &rng, uint32_t seed, uint32_t stream) {
+    uint64_t x = ((uint64_t)stream << 32) | seed;
+    for (uint8_t i = 0; i < 4; i += 2) {
+        uint64_t z = splitMix64(x);
+        rng.s[i] = (uint32_t)z;
+        rng.s[i + 1] = (uint32_t)(z >> 32);
+    }
+}
+
+uint32_t simRandomBelow(SimRandom &rng, uint32_t bound) {
+    uint64_t m = (uint64_t)simRandomNext(rng) * bound;
+    uint32_t low = (uint32_t)m;
+    if (low < bound) {
+        // Reject the 2^32 mod bound lowest products so every value is
+        // equally likely
+        uint32_t threshold = (0U - bound) % bound;
+        while (low < threshold) {
+            m = (uint64_t)simRandomNext(rng) * bound;
+            low = (uint32_t)m;
+        }
+    }
+    return (uint32_t)(m >> 32);
+}
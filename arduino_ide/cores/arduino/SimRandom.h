@@ -0,0 +1,47 @@
+/*
+  SimRandom.h - Pseudo-random generator behind random()/randomSeed()
+
+  xoshiro128** (Blackman and Vigna): 128 bits of state, 32-bit outputs, and
+  only 32-bit shifts, rotates, adds and xors, so it is cheap on AVR and
+  yields the same sequence on every target. Bounded values use Lemire's
+  multiply-shift with rejection, which is free of modulo bias and almost
+  never divides.
+
+  The seed is expanded with SplitMix64 together with a stream number; the
+  core uses the context id, so simulated boards given the same seed still
+  draw independent sequences, while the default context matches a real
+  board.
+*/
+
+#ifndef SimRandom_h
+#define SimRandom_h
+
+#include <stdint.h>
+
+struct SimRandom {
+    uint32_t s[4];
+};
+
+// State of randomSeed(1) on stream 0, the power-on default
+#define SIM_RANDOM_DEFAULT { { 0x89025cc1, 0x910a2dec, 0x658eec67, 0xbeeb8da1 } }
+
+void simRandomSeed(SimRandom &rng, uint32_t seed, uint32_t stream);
+
+inline uint32_t simRandomNext(SimRandom &rng) {
+    uint32_t *s = rng.s;
+    uint32_t x = s[1] * 5;
+    uint32_t result = ((x << 7) | (x >> 25)) * 9;
+    uint32_t t = s[1] << 9;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 11) | (s[3] >> 21);
+    return result;
+}
+
+// Uniform in [0, bound); 0 if bound is 0
+uint32_t simRandomBelow(SimRandom &rng, uint32_t bound);
+
+#endif
@@ -0,0 +1,199 @@
+/*
+  SimScheduler.cpp - Discrete-event kernel driving setup()/loop()
+*/
+
+#include "Arduino.h"
+
+#define SCHEDULER_INITIAL_CAPACITY 16
+
+static bool eventBefore(const SimEvent &a, const SimEvent &b) {
+    if (a.time_us != b.time_us) {
+        return a.time_us < b.time_us;
+    }
+    // Sequence numbers wrap; compare by signed distance
+    return (int32_t)(a.seq - b.seq) < 0;
+}
+
+static void heapSiftUp(SimScheduler &sched, size_t i) {
+    SimEvent *heap = sched.heap;
+    SimEvent ev = heap[i];
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!eventBefore(ev, heap[parent])) {
+            break;
+        }
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = ev;
+}
+
+static void heapSiftDown(SimScheduler &sched, size_t i) {
+    SimEvent *heap = sched.heap;
+    size_t count = sched.count;
+    SimEvent ev = heap[i];
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= count) {
+            break;
+        }
+        if (child + 1 < count && eventBefore(heap[child + 1], heap[child])) {
+            child++;
+        }
+        if (!eventBefore(heap[child], ev)) {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = ev;
+}
+
+static SimEvent heapPop(SimScheduler &sched) {
+    SimEvent top = sched.heap[0];
+    sched.count--;
+    if (sched.count > 0) {
+        sched.heap[0] = sched.heap[sched.count];
+        heapSiftDown(sched, 0);
+    }
+    return top;
+}
+
+static void dispatch(const SimEvent &ev) {
+    clockSleepUntil(ev.time_us);
+    ev.handler(ev.arg);
+    // Interrupts the event raised are serviced at its instant
+    if (simContext()->irq != NULL) {
+        irqService();
+    }
+    serialDrainTx();
+}
+
+static void runLoop(void *arg) {
+    (void)arg;
+    SimContext *ctx = simContext();
+    SimScheduler &sched = ctx->scheduler;
+    stringLoopBegin();
+    ctx->loop();
+    stringLoopEnd();
+    serialEventRun();
+    sched.loops++;
+    if (sched.loop_limit != 0 && sched.loops >= sched.loop_limit) {
+        sched.stopped = true;
+        return;
+    }
+    schedulerPost(clockMicros64() + sched.loop_period_us, SIM_EVENT_LOOP, runLoop, NULL);
+}
+
+bool schedulerPost(uint64_t time_us, uint8_t type, SimEventHandler handler, void *arg) {
+    SimScheduler &sched = simContext()->scheduler;
+    if (sched.count == sched.capacity) {
+        size_t capacity = sched.capacity ? sched.capacity * 2 : SCHEDULER_INITIAL_CAPACITY;
+        SimEvent *heap = (SimEvent *)realloc(sched.heap, capacity * sizeof(SimEvent));
+        if (heap == NULL) {
+            return false;
+        }
+        sched.heap = heap;
+        sched.capacity = capacity;
+    }
+
+    SimEvent &ev = sched.heap[sched.count];
+    ev.time_us = time_us;
+    ev.seq = sched.next_seq++;
+    ev.type = type;
+    ev.handler = handler;
+    ev.arg = arg;
+    heapSiftUp(sched, sched.count++);
+    return true;
+}
+
+void schedulerSetTimeLimit(uint64_t us) {
+    simContext()->scheduler.time_limit_us = us;
+}
+
+void schedulerSetLoopLimit(uint64_t iterations) {
+    simContext()->scheduler.loop_limit = iterations;
+}
+
+void schedulerSetLoopPeriod(uint32_t us) {
+    simContext()->scheduler.loop_period_us = us;
+}
+
+void schedulerStop(void) {
+    simContext()->scheduler.stopped = true;
+}
+
+bool schedulerStopped(void) {
+    return simContext()->scheduler.stopped;
+}
+
+void schedulerSleepUntil(uint64_t deadline_us) {
+    SimScheduler &sched = simContext()->scheduler;
+    if (simContext()->irq != NULL) {
+        irqService();
+    }
+    // What the sketch printed goes out before it sleeps
+    serialDrainTx();
+    uint64_t limit = sched.time_limit_us;
+    if (limit != 0 && deadline_us >= limit) {
+        deadline_us = limit;
+        sched.stopped = true;
+    }
+
+    while (sched.count > 0 && sched.heap[0].time_us <= deadline_us) {
+        dispatch(heapPop(sched));
+    }
+    clockSleepUntil(deadline_us);
+}
+
+static uint64_t envNumber(const char *name, uint64_t fallback) {
+#if defined(__AVR__)
+    (void)name;
+    return fallback;
+#else
+    const char *value = getenv(name);
+    if (value == NULL || *value == '\0') {
+        return fallback;
+    }
+    return strtoull(value, NULL, 10);
+#endif
+}
+
+void schedulerInit(void) {
+    SimScheduler &sched = simContext()->scheduler;
+    sched.count = 0;
+    sched.loops = 0;
+    sched.stopped = false;
+    sched.time_limit_us = envNumber("ARDUINO_SIM_TIME_LIMIT_US", 0);
+    sched.loop_limit = envNumber("ARDUINO_SIM_LOOP_LIMIT", 0);
+    sched.loop_period_us = (uint32_t)envNumber("ARDUINO_SIM_LOOP_PERIOD_US", 1);
+}
+
+void schedulerStart(void) {
+    if (!simContext()->scheduler.stopped) {
+        schedulerPost(clockMicros64(), SIM_EVENT_LOOP, runLoop, NULL);
+    }
+}
+
+bool schedulerStep(size_t max_events) {
+    SimScheduler &sched = simContext()->scheduler;
+    uint64_t limit = sched.time_limit_us;
+    while (max_events-- > 0) {
+        if (sched.stopped || sched.count == 0) {
+            return false;
+        }
+        if (limit != 0 && sched.heap[0].time_us > limit) {
+            clockSetTime(limit);
+            sched.stopped = true;
+            return false;
+        }
+        dispatch(heapPop(sched));
+    }
+    return !sched.stopped && sched.count > 0;
+}
+
+void schedulerRun(void) {
+    schedulerStart();
+    while (schedulerStep(SIZE_MAX)) {
+    }
+}
@@ -0,0 +1,81 @@
+/*
+  SimScheduler.h - Discrete-event kernel driving setup()/loop()
+
+  Everything that happens to a simulated board is an event on a single
+  timeline: loop() iterations, timer edges and serial byte arrivals.
+  Events are dispatched in time order (ties in posting order) until the
+  queue drains or a simulated-time or loop-iteration budget is reached.
+  Pending interrupts are serviced after each event (SimInterrupts.h), and
+  analogRead() computes its value at the time of the read (SimAdc.h), so
+  neither needs events of its own.
+*/
+
+#ifndef SimScheduler_h
+#define SimScheduler_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+// What an event is for; the scheduler itself does not look at it
+enum SimEventType {
+    SIM_EVENT_LOOP,
+    SIM_EVENT_TIMER,
+    SIM_EVENT_SERIAL_RX
+};
+
+typedef void (*SimEventHandler)(void *arg);
+
+struct SimEvent {
+    uint64_t time_us;
+    uint32_t seq;
+    uint8_t type;
+    SimEventHandler handler;
+    void *arg;
+};
+
+struct SimScheduler {
+    SimEvent *heap;          // binary min-heap ordered by (time_us, seq)
+    size_t count;
+    size_t capacity;
+    uint32_t next_seq;
+    uint64_t time_limit_us;  // 0 = unbounded
+    uint64_t loop_limit;     // 0 = unbounded
+    uint64_t loops;
+    uint32_t loop_period_us; // simulated time charged per loop() iteration
+    bool stopped;
+};
+
+// Queues handler(arg) to run at time_us. Returns false when out of memory.
+bool schedulerPost(uint64_t time_us, uint8_t type, SimEventHandler handler, void *arg);
+
+void schedulerSetTimeLimit(uint64_t us);
+void schedulerSetLoopLimit(uint64_t iterations);
+void schedulerSetLoopPeriod(uint32_t us);
+
+// Ends the run once the current event returns
+void schedulerStop(void);
+bool schedulerStopped(void);
+
+// Dispatches every event due up to deadline_us and leaves the clock at
+// the deadline, or at the time limit if that comes first. Used by delay()
+// so events keep firing while the sketch sleeps. Pending interrupts are
+// serviced, and buffered Serial output handed to its backend, on entry
+// and after every event.
+void schedulerSleepUntil(uint64_t deadline_us);
+
+// Reads ARDUINO_SIM_TIME_LIMIT_US, ARDUINO_SIM_LOOP_LIMIT and
+// ARDUINO_SIM_LOOP_PERIOD_US, called by main()
+void schedulerInit(void);
+
+// Queues the first loop() iteration; setup() must already have run
+void schedulerStart(void);
+
+// Dispatches at most max_events events. Returns false once the run is
+// over, so a caller can interleave several instances.
+bool schedulerStep(size_t max_events);
+
+// Runs loop() and all queued events until the queue drains or a budget
+// is exhausted
+void schedulerRun(void);
+
+#endif
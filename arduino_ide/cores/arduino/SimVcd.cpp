@@ -0,0 +1,255 @@
+/*
+  SimVcd.cpp - IEEE 1364 VCD recorder for simulated pin activity
+*/
+
+#if !defined(__AVR__)
+// Standard library headers must come before Arduino.h and its macros
+#include <thread>
+#endif
+
+#include "Arduino.h"
+#include "RingBuffer.h"
+
+#if defined(__AVR__)
+
+bool vcdBegin(const char *path, size_t capacity) {
+    (void)path;
+    (void)capacity;
+    return false;
+}
+
+void vcdEnd(void) {
+}
+
+bool vcdRecording(void) {
+    return false;
+}
+
+void vcdRecordPort(SimVcd *vcd, uint8_t port, uint8_t value) {
+    (void)vcd;
+    (void)port;
+    (void)value;
+}
+
+void vcdRecordAverage(SimVcd *vcd, uint8_t pin, float average) {
+    (void)vcd;
+    (void)pin;
+    (void)average;
+}
+
+void vcdInit(void) {
+}
+
+#else
+
+#include <stdio.h>
+#include <time.h>
+
+#define VCD_FILE_BUFFER (1 << 20)
+#define VCD_DRAIN_BATCH 1024
+#define VCD_IDLE_SLEEP_NS 200000
+
+// Port changes carry the new PINx value; averaged-level changes use
+// VCD_AVERAGE as the port and carry the pin
+#define VCD_AVERAGE 0xFF
+
+struct VcdChange {
+    uint64_t time_us;
+    uint8_t port;
+    uint8_t value;
+    float average;
+};
+
+struct SimVcd {
+    SpscRing<VcdChange> ring;
+    FILE *file;
+    char *file_buffer;
+    std::thread writer;
+    bool running;
+    uint8_t last[NUM_PORTS];
+    uint8_t pin_at[NUM_PORTS][8];  // pin number of each port bit, 0xFF if none
+    uint64_t last_time_us;
+};
+
+// Single printable character per pin: '!' for D0, '"' for D1, ...
+static char vcdIdentifier(uint8_t pin) {
+    return (char)('!' + pin);
+}
+
+// Averaged levels follow the pins, one per timer output
+static char vcdAverageIdentifier(uint8_t pin) {
+    return (char)('!' + NUM_DIGITAL_PINS + digitalPinToTimer(pin) - 1);
+}
+
+static void vcdWriteHeader(SimVcd *vcd) {
+    FILE *file = vcd->file;
+    time_t now = time(NULL);
+    char date[64];
+    strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", localtime(&now));
+
+    fprintf(file, "$date %s $end\n", date);
+    fprintf(file, "$version Arduino IDE host core $end\n");
+    fprintf(file, "$timescale 1us $end\n");
+    fprintf(file, "$scope module board%u $end\n", (unsigned)simContext()->id);
+    for (uint8_t pin = 0; pin < NUM_DIGITAL_PINS; pin++) {
+        if (pin >= A0) {
+            fprintf(file, "$var wire 1 %c A%u $end\n", vcdIdentifier(pin), (unsigned)(pin - A0));
+        } else {
+            fprintf(file, "$var wire 1 %c D%u $end\n", vcdIdentifier(pin), (unsigned)pin);
+        }
+    }
+    for (uint8_t pin = 0; pin < NUM_DIGITAL_PINS; pin++) {
+        if (digitalPinToTimer(pin) != NOT_ON_TIMER) {
+            fprintf(file, "$var real 64 %c D%u_avg $end\n", vcdAverageIdentifier(pin), (unsigned)pin);
+        }
+    }
+    fprintf(file, "$upscope $end\n$enddefinitions $end\n");
+
+    fprintf(file, "#%llu\n$dumpvars\n", (unsigned long long)vcd->last_time_us);
+    for (uint8_t pin = 0; pin < NUM_DIGITAL_PINS; pin++) {
+        uint8_t level = vcd->last[digitalPinToPort(pin)] & digitalPinToBitMask(pin);
+        fprintf(file, "%c%c\n", level ? '1' : '0', vcdIdentifier(pin));
+    }
+    for (uint8_t pin = 0; pin < NUM_DIGITAL_PINS; pin++) {
+        if (digitalPinToTimer(pin) != NOT_ON_TIMER) {
+            fprintf(file, "r%.9g %c\n", (double)pwmAverage(pin), vcdAverageIdentifier(pin));
+        }
+    }
+    fprintf(file, "$end\n");
+}
+
+static void vcdWriteChange(SimVcd *vcd, const VcdChange &change) {
+    FILE *file = vcd->file;
+    if (change.time_us != vcd->last_time_us) {
+        fprintf(file, "#%llu\n", (unsigned long long)change.time_us);
+        vcd->last_time_us = change.time_us;
+    }
+
+    if (change.port == VCD_AVERAGE) {
+        fprintf(file, "r%.9g %c\n", (double)change.average, vcdAverageIdentifier(change.value));
+        return;
+    }
+    uint8_t changed = change.value ^ vcd->last[change.port];
+    for (uint8_t bit = 0; changed != 0; bit++, changed >>= 1) {
+        uint8_t pin = vcd->pin_at[change.port][bit];
+        if ((changed & 1) && pin != 0xFF) {
+            putc((change.value >> bit) & 1 ? '1' : '0', file);
+            putc(vcdIdentifier(pin), file);
+            putc('\n', file);
+        }
+    }
+    vcd->last[change.port] = change.value;
+}
+
+static void vcdWriterMain(SimVcd *vcd) {
+    VcdChange batch[VCD_DRAIN_BATCH];
+    for (;;) {
+        // Sample the flag before draining so nothing pushed before
+        // vcdEnd() is left behind
+        bool running = __atomic_load_n(&vcd->running, __ATOMIC_ACQUIRE);
+        size_t count = vcd->ring.popBulk(batch, VCD_DRAIN_BATCH);
+        for (size_t i = 0; i < count; i++) {
+            vcdWriteChange(vcd, batch[i]);
+        }
+        if (count == 0) {
+            if (!running) {
+                break;
+            }
+            struct timespec idle = { 0, VCD_IDLE_SLEEP_NS };
+            nanosleep(&idle, NULL);
+        }
+    }
+    fflush(vcd->file);
+}
+
+bool vcdBegin(const char *path, size_t capacity) {
+    SimPins &pins = simContext()->pins;
+    if (pins.vcd != NULL) {
+        return false;
+    }
+
+    SimVcd *vcd = new SimVcd;
+    vcd->file = fopen(path, "w");
+    if (vcd->file == NULL || !vcd->ring.allocate(capacity)) {
+        if (vcd->file != NULL) {
+            fclose(vcd->file);
+        }
+        delete vcd;
+        return false;
+    }
+    vcd->file_buffer = (char *)malloc(VCD_FILE_BUFFER);
+    if (vcd->file_buffer != NULL) {
+        setvbuf(vcd->file, vcd->file_buffer, _IOFBF, VCD_FILE_BUFFER);
+    }
+
+    memset(vcd->pin_at, 0xFF, sizeof(vcd->pin_at));
+    for (uint8_t pin = 0; pin < NUM_DIGITAL_PINS; pin++) {
+        uint8_t mask = digitalPinToBitMask(pin);
+        uint8_t bit = 0;
+        while ((mask >> bit) != 1) {
+            bit++;
+        }
+        vcd->pin_at[digitalPinToPort(pin)][bit] = pin;
+    }
+    memcpy(vcd->last, pins.pin, sizeof(vcd->last));
+    vcd->last_time_us = clockMicros64();
+    vcdWriteHeader(vcd);
+
+    vcd->running = true;
+    vcd->writer = std::thread(vcdWriterMain, vcd);
+    pins.vcd = vcd;
+    return true;
+}
+
+void vcdEnd(void) {
+    SimPins &pins = simContext()->pins;
+    SimVcd *vcd = pins.vcd;
+    if (vcd == NULL) {
+        return;
+    }
+    pins.vcd = NULL;
+
+    __atomic_store_n(&vcd->running, false, __ATOMIC_RELEASE);
+    vcd->writer.join();
+    fclose(vcd->file);
+    free(vcd->file_buffer);
+    delete vcd;
+}
+
+bool vcdRecording(void) {
+    return simContext()->pins.vcd != NULL;
+}
+
+static void vcdPush(SimVcd *vcd, const VcdChange &change) {
+    // Lossless: if the writer falls behind, the sketch waits for it
+    while (!vcd->ring.push(change)) {
+        std::this_thread::yield();
+    }
+}
+
+void vcdRecordPort(SimVcd *vcd, uint8_t port, uint8_t value) {
+    VcdChange change;
+    change.time_us = clockMicros64();
+    change.port = port;
+    change.value = value;
+    change.average = 0.0f;
+    vcdPush(vcd, change);
+}
+
+void vcdRecordAverage(SimVcd *vcd, uint8_t pin, float average) {
+    VcdChange change;
+    change.time_us = clockMicros64();
+    change.port = VCD_AVERAGE;
+    change.value = pin;
+    change.average = average;
+    vcdPush(vcd, change);
+}
+
+void vcdInit(void) {
+    const char *path = getenv("ARDUINO_VCD");
+    if (path != NULL && *path != '\0') {
+        vcdBegin(path);
+    }
+}
+
+#endif
@@ -0,0 +1,46 @@
+/*
+  SimVcd.h - IEEE 1364 VCD recorder for simulated pin activity
+
+  While recording, every change of a port's PINx register is pushed into
+  a lock-free ring buffer together with the instance's micros(). A
+  background thread drains the ring and streams the transitions to a
+  .vcd file, so traces can grow far beyond available memory. When no
+  recorder is attached the pin layer only tests a null pointer.
+
+  Besides one wire per pin, the trace has a real variable per PWM pin
+  (D3_avg, ...) holding the fraction of time it is high, updated by
+  analogWrite() and when PWM stops.
+
+  Host builds only; on AVR vcdBegin() always fails.
+*/
+
+#ifndef SimVcd_h
+#define SimVcd_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Default ring capacity in port transitions
+#define VCD_RING_CAPACITY 65536
+
+struct SimVcd;
+
+// Starts recording the current instance's pins to path. Returns false
+// if the file cannot be created or a recording is already running.
+bool vcdBegin(const char *path, size_t capacity = VCD_RING_CAPACITY);
+
+// Flushes outstanding transitions, stops the writer and closes the file
+void vcdEnd(void);
+
+bool vcdRecording(void);
+
+// Starts recording to $ARDUINO_VCD if set, called by main()
+void vcdInit(void);
+
+// Called by the pin layer when PINx of port changes to value
+void vcdRecordPort(SimVcd *vcd, uint8_t port, uint8_t value);
+
+// Called by the timer model when the averaged level of a PWM pin changes
+void vcdRecordAverage(SimVcd *vcd, uint8_t pin, float average);
+
+#endif
@@ -0,0 +1,117 @@
+/*
+  StringAllocator.cpp - Memory sources for String buffers
+*/
+
+#include "Arduino.h"
+
+HeapStringAllocator stringHeap;
+
+void *HeapStringAllocator::allocate(size_t size) {
+    return malloc(size);
+}
+
+void HeapStringAllocator::release(void *ptr, size_t size) {
+    (void)size;
+    free(ptr);
+}
+
+// Pool
+
+PoolStringAllocator::PoolStringAllocator(void *storage, size_t block_size, size_t blocks)
+    : _free(NULL), _block_size(block_size) {
+    // Thread the free list from the last block so blocks go out in order
+    uint8_t *base = (uint8_t *)storage;
+    for (size_t i = blocks; i > 0; --i) {
+        Block *block = (Block *)(base + (i - 1) * block_size);
+        block->next = _free;
+        _free = block;
+    }
+}
+
+void *PoolStringAllocator::allocate(size_t size) {
+    if (size > _block_size || _free == NULL) {
+        return NULL;
+    }
+    Block *block = _free;
+    _free = block->next;
+    noteAllocate(_block_size);
+    return block;
+}
+
+void PoolStringAllocator::release(void *ptr, size_t size) {
+    (void)size;
+    Block *block = (Block *)ptr;
+    block->next = _free;
+    _free = block;
+    noteRelease(_block_size);
+}
+
+bool PoolStringAllocator::resize(void *ptr, size_t old_size, size_t new_size) {
+    (void)ptr;
+    (void)old_size;
+    return new_size <= _block_size;
+}
+
+// Arena
+
+void *ArenaStringAllocator::allocate(size_t size) {
+    if (size > (size_t)(_end - _top)) {
+        return NULL;
+    }
+    void *ptr = _top;
+    _top += size;
+    noteAllocate(size);
+    return ptr;
+}
+
+void ArenaStringAllocator::release(void *ptr, size_t size) {
+    if ((uint8_t *)ptr + size == _top) {
+        _top = (uint8_t *)ptr;
+        noteRelease(size);
+    }
+}
+
+bool ArenaStringAllocator::resize(void *ptr, size_t old_size, size_t new_size) {
+    // Only the most recent block has free space behind it
+    if ((uint8_t *)ptr + old_size != _top || new_size - old_size > (size_t)(_end - _top)) {
+        return false;
+    }
+    _top += new_size - old_size;
+    noteGrow(new_size - old_size);
+    return true;
+}
+
+void ArenaStringAllocator::reset(void) {
+    noteRelease(_top - _base);
+    _top = _base;
+}
+
+// Selection
+
+void stringSetAllocator(StringAllocator *allocator) {
+    simContext()->string_allocator = allocator;
+}
+
+void stringSetLoopArena(ArenaStringAllocator *arena) {
+    simContext()->string_loop_arena = arena;
+}
+
+StringAllocator *stringAllocator(void) {
+    SimContext *ctx = simContext();
+    if (ctx->in_loop && ctx->string_loop_arena != NULL) {
+        return ctx->string_loop_arena;
+    }
+    return ctx->string_allocator != NULL ? ctx->string_allocator : &stringHeap;
+}
+
+void stringLoopBegin(void) {
+    simContext()->in_loop = true;
+}
+
+void stringLoopEnd(void) {
+    SimContext *ctx = simContext();
+    ctx->in_loop = false;
+    if (ctx->string_loop_arena != NULL) {
+        ctx->string_loop_arena->reset();
+    }
+}
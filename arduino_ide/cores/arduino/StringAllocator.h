@@ -0,0 +1,163 @@
+/*
+  StringAllocator.h - Memory sources for String buffers
+
+  Every String remembers the allocator its buffer comes from. New Strings
+  take the current context's default: the heap, or whatever
+  stringSetAllocator() selected. Two alternatives keep a small heap from
+  fragmenting:
+
+    StringPool<BlockSize, Blocks>  fixed-size blocks on a free list; any
+                                   request up to BlockSize takes one block
+    StringArena<Size>              a bump allocator; with stringSetLoopArena()
+                                   it serves every String created inside
+                                   loop() and is emptied after each iteration
+
+  Both allocate and free in O(1) and record how much of them was in use at
+  the worst moment (peak()), which is how to size them. When one runs out,
+  the String asking for memory moves to the heap and overflows() counts it.
+
+  Strings created inside loop() while a loop arena is set must not outlive
+  the iteration: a static local or a String stored in a global must be
+  created with an explicit allocator, e.g. String(&stringHeap). Moving an
+  arena String into a longer-lived one copies the text.
+*/
+
+#ifndef StringAllocator_h
+#define StringAllocator_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+class StringAllocator {
+public:
+    constexpr StringAllocator() : _used(0), _peak(0), _allocations(0), _overflows(0) {}
+    virtual ~StringAllocator() {}
+
+    // Returns size bytes, or NULL if the allocator cannot provide them
+    virtual void *allocate(size_t size) = 0;
+    // Gives back a block returned by allocate(); size is the size asked for
+    virtual void release(void *ptr, size_t size) = 0;
+    // Grows the block at ptr to new_size without moving it, if possible
+    virtual bool resize(void *ptr, size_t old_size, size_t new_size) {
+        (void)ptr;
+        (void)old_size;
+        (void)new_size;
+        return false;
+    }
+
+    // Bytes in use now and at most so far, successful allocations, and
+    // requests that could not be served
+    size_t used(void) const { return _used; }
+    size_t peak(void) const { return _peak; }
+    uint32_t allocations(void) const { return _allocations; }
+    uint32_t overflows(void) const { return _overflows; }
+
+    void noteOverflow(void) { _overflows++; }
+
+protected:
+    void noteAllocate(size_t size) {
+        _allocations++;
+        noteGrow(size);
+    }
+    void noteGrow(size_t size) {
+        _used += size;
+        if (_used > _peak) {
+            _peak = _used;
+        }
+    }
+    void noteRelease(size_t size) { _used -= size; }
+
+private:
+    size_t _used;
+    size_t _peak;
+    uint32_t _allocations;
+    uint32_t _overflows;
+};
+
+// malloc() and free(). Shared by every context, so it keeps no statistics.
+class HeapStringAllocator : public StringAllocator {
+public:
+    constexpr HeapStringAllocator() {}
+    void *allocate(size_t size) override;
+    void release(void *ptr, size_t size) override;
+};
+
+extern HeapStringAllocator stringHeap;
+
+// Blocks of block_size bytes carved from storage. Blocks must be able to
+// hold a pointer, and storage must be aligned for one.
+class PoolStringAllocator : public StringAllocator {
+public:
+    PoolStringAllocator(void *storage, size_t block_size, size_t blocks);
+    void *allocate(size_t size) override;
+    void release(void *ptr, size_t size) override;
+    bool resize(void *ptr, size_t old_size, size_t new_size) override;
+
+    size_t blockSize(void) const { return _block_size; }
+
+private:
+    struct Block {
+        Block *next;
+    };
+
+    Block *_free;
+    size_t _block_size;
+};
+
+template <size_t BlockSize, size_t Blocks>
+class StringPool : public PoolStringAllocator {
+public:
+    static_assert(BlockSize >= sizeof(void *), "pool blocks must hold a pointer");
+    static_assert(BlockSize % sizeof(void *) == 0, "pool blocks must keep pointer alignment");
+
+    StringPool() : PoolStringAllocator(_storage, BlockSize, Blocks) {}
+
+private:
+    void *_storage[BlockSize * Blocks / sizeof(void *)];
+};
+
+// Bytes handed out from the front of storage. release() only reclaims the
+// most recent block; reset() reclaims everything at once.
+class ArenaStringAllocator : public StringAllocator {
+public:
+    ArenaStringAllocator(void *storage, size_t size)
+        : _base((uint8_t *)storage), _top((uint8_t *)storage), _end((uint8_t *)storage + size) {}
+    void *allocate(size_t size) override;
+    void release(void *ptr, size_t size) override;
+    bool resize(void *ptr, size_t old_size, size_t new_size) override;
+
+    // Forgets every allocation; peak() is kept
+    void reset(void);
+    size_t capacity(void) const { return _end - _base; }
+
+private:
+    uint8_t *_base;
+    uint8_t *_top;
+    uint8_t *_end;
+};
+
+template <size_t Size>
+class StringArena : public ArenaStringAllocator {
+public:
+    StringArena() : ArenaStringAllocator(_storage, Size) {}
+
+private:
+    uint8_t _storage[Size];
+};
+
+// Allocator for Strings created from now on by the current context; NULL
+// selects the heap
+void stringSetAllocator(StringAllocator *allocator);
+
+// Arena serving Strings created inside loop(); it is reset after every
+// iteration. NULL turns it off.
+void stringSetLoopArena(ArenaStringAllocator *arena);
+
+// The allocator a String created now would use
+StringAllocator *stringAllocator(void);
+
+// Called by the scheduler around each loop() iteration
+void stringLoopBegin(void);
+void stringLoopEnd(void);
+
+#endif
@@ -0,0 +1,65 @@
+/*
+  Telemetry.h - Binary framing of channel samples over Serial
+
+  A frame carries one sample per channel, all of the same type:
+
+    offset  size  field
+    0       2     sync, 0xA5 0x5A
+    2       2     payload length in bytes, little endian
+    4       1     sample type (TELEMETRY_*)
+    5       1     channel count
+    6       1     sequence number, +1 per frame, wraps at 256
+    7       len   samples, little endian
+    7+len   2     CRC-16/CCITT-FALSE of bytes 2 .. 6+len, little endian
+
+  The IDE's plotter decodes these frames without parsing text, and the
+  sequence number lets it count frames lost on the way. A frame is queued
+  with one Serial.write() of three spans, so it is never interleaved with
+  other output.
+*/
+
+#ifndef Telemetry_h
+#define Telemetry_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TELEMETRY_SYNC0 0xA5
+#define TELEMETRY_SYNC1 0x5A
+
+#define TELEMETRY_HEADER_SIZE 7
+#define TELEMETRY_CRC_SIZE 2
+
+// Sample types
+#define TELEMETRY_UINT8   1
+#define TELEMETRY_INT16   2
+#define TELEMETRY_INT32   3
+#define TELEMETRY_FLOAT32 4
+
+// Size of one sample of type, 0 if unknown
+uint8_t telemetrySampleSize(uint8_t type);
+
+// CRC-16/CCITT-FALSE (polynomial 0x1021) continued from crc, 0xFFFF to start
+uint16_t telemetryCrc16(uint16_t crc, const uint8_t *data, size_t size);
+
+// Queues one frame of channels samples on Serial. Returns the frame size
+// in bytes, or 0 if the type is unknown or Serial is not open.
+size_t telemetrySend(uint8_t type, const void *samples, uint8_t channels);
+
+inline size_t telemetrySend(const uint8_t *samples, uint8_t channels) {
+    return telemetrySend(TELEMETRY_UINT8, samples, channels);
+}
+
+inline size_t telemetrySend(const int16_t *samples, uint8_t channels) {
+    return telemetrySend(TELEMETRY_INT16, samples, channels);
+}
+
+inline size_t telemetrySend(const int32_t *samples, uint8_t channels) {
+    return telemetrySend(TELEMETRY_INT32, samples, channels);
+}
+
+inline size_t telemetrySend(const float *samples, uint8_t channels) {
+    return telemetrySend(TELEMETRY_FLOAT32, samples, channels);
+}
+
+#endif
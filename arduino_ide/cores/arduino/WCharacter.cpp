@@ -0,0 +1,182 @@
+/*
+  WCharacter.cpp - Character class table and bulk classification
+
+  The span kernels take 32 bytes per step where the compiler targets AVX2
+  (e.g. -mavx2 or -march=native), 16 with SSE2 (every x86-64 host), and
+  finish byte by byte, which is all AVR builds do.
+*/
+
+#if !defined(__AVR__)
+// Standard library headers must come before Arduino.h and its macros
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#endif
+
+#include "Arduino.h"
+
+#define CLASS_ROW(row) \
+    characterClassOf(row + 0x0), characterClassOf(row + 0x1), characterClassOf(row + 0x2), \
+    characterClassOf(row + 0x3), characterClassOf(row + 0x4), characterClassOf(row + 0x5), \
+    characterClassOf(row + 0x6), characterClassOf(row + 0x7), characterClassOf(row + 0x8), \
+    characterClassOf(row + 0x9), characterClassOf(row + 0xA), characterClassOf(row + 0xB), \
+    characterClassOf(row + 0xC), characterClassOf(row + 0xD), characterClassOf(row + 0xE), \
+    characterClassOf(row + 0xF)
+
+const uint8_t characterClasses[256] PROGMEM = {
+    CLASS_ROW(0x00), CLASS_ROW(0x10), CLASS_ROW(0x20), CLASS_ROW(0x30),
+    CLASS_ROW(0x40), CLASS_ROW(0x50), CLASS_ROW(0x60), CLASS_ROW(0x70),
+    CLASS_ROW(0x80), CLASS_ROW(0x90), CLASS_ROW(0xA0), CLASS_ROW(0xB0),
+    CLASS_ROW(0xC0), CLASS_ROW(0xD0), CLASS_ROW(0xE0), CLASS_ROW(0xF0),
+};
+
+static_assert(characterClassOf('7') == (CHAR_DIGIT | CHAR_XDIGIT), "digit classes");
+static_assert(characterClassOf(' ') == (CHAR_SPACE | CHAR_SP), "space classes");
+static_assert(characterClassOf(0x80) == 0, "no classes above ASCII");
+
+// The bytes index the table directly: as unsigned char they are all in range
+static inline uint8_t classAt(const char *text, size_t i) {
+    return pgm_read_byte(&characterClasses[(uint8_t)text[i]]);
+}
+
+void classifyCharacters(const char *text, size_t size, uint8_t *classes) {
+    for (size_t i = 0; i < size; ++i) {
+        classes[i] = classAt(text, i);
+    }
+}
+
+size_t spanCharacters(const char *text, size_t size, uint8_t mask) {
+    size_t i = 0;
+    while (i < size && (classAt(text, i) & mask) != 0) {
+        i++;
+    }
+    return i;
+}
+
+size_t spanCharactersNot(const char *text, size_t size, uint8_t mask) {
+    size_t i = 0;
+    while (i < size && (classAt(text, i) & mask) == 0) {
+        i++;
+    }
+    return i;
+}
+
+size_t countCharacters(const char *text, size_t size, uint8_t mask) {
+    size_t count = 0;
+    for (size_t i = 0; i < size; ++i) {
+        count += (classAt(text, i) & mask) != 0;
+    }
+    return count;
+}
+
+// Span kernels. Signed byte compares leave bytes 128-255 out of every
+// ASCII range, as the class table does.
+
+// Flips bit 5 (the case bit) of every character from first to last
+static void flipCase(char *text, size_t size, char first, char last) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i below32 = _mm256_set1_epi8(first - 1);
+    const __m256i above32 = _mm256_set1_epi8(last + 1);
+    const __m256i bit32 = _mm256_set1_epi8(0x20);
+    for (; i + 32 <= size; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(text + i));
+        __m256i in = _mm256_and_si256(_mm256_cmpgt_epi8(v, below32), _mm256_cmpgt_epi8(above32, v));
+        _mm256_storeu_si256((__m256i *)(text + i), _mm256_xor_si256(v, _mm256_and_si256(in, bit32)));
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i below = _mm_set1_epi8(first - 1);
+    const __m128i above = _mm_set1_epi8(last + 1);
+    const __m128i bit = _mm_set1_epi8(0x20);
+    for (; i + 16 <= size; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(text + i));
+        __m128i in = _mm_and_si128(_mm_cmpgt_epi8(v, below), _mm_cmpgt_epi8(above, v));
+        _mm_storeu_si128((__m128i *)(text + i), _mm_xor_si128(v, _mm_and_si128(in, bit)));
+    }
+#endif
+    for (; i < size; ++i) {
+        if (text[i] >= first && text[i] <= last) {
+            text[i] ^= 0x20;
+        }
+    }
+}
+
+void lowerCaseCharacters(char *text, size_t size) {
+    flipCase(text, size, 'A', 'Z');
+}
+
+void upperCaseCharacters(char *text, size_t size) {
+    flipCase(text, size, 'a', 'z');
+}
+
+size_t findNonPrintable(const char *text, size_t size) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i below32 = _mm256_set1_epi8(' ' - 1);
+    const __m256i above32 = _mm256_set1_epi8('~' + 1);
+    for (; i + 32 <= size; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(text + i));
+        __m256i printable = _mm256_and_si256(_mm256_cmpgt_epi8(v, below32), _mm256_cmpgt_epi8(above32, v));
+        uint32_t other = ~(uint32_t)_mm256_movemask_epi8(printable);
+        if (other != 0) {
+            return i + __builtin_ctz(other);
+        }
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i below = _mm_set1_epi8(' ' - 1);
+    const __m128i above = _mm_set1_epi8('~' + 1);
+    for (; i + 16 <= size; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(text + i));
+        __m128i printable = _mm_and_si128(_mm_cmpgt_epi8(v, below), _mm_cmpgt_epi8(above, v));
+        uint32_t other = ~(uint32_t)_mm_movemask_epi8(printable) & 0xFFFF;
+        if (other != 0) {
+            return i + __builtin_ctz(other);
+        }
+    }
+#endif
+    while (i < size && isPrintable((uint8_t)text[i])) {
+        i++;
+    }
+    return i;
+}
+
+size_t countOccurrences(const char *text, size_t size, char c) {
+    size_t i = 0;
+    size_t count = 0;
+    // Per-lane byte counters are summed before they can wrap at 255
+#if defined(__AVX2__)
+    const __m256i match32 = _mm256_set1_epi8(c);
+    while (i + 32 <= size) {
+        size_t end = size - i >= 255 * 32 ? i + 255 * 32 : size - (size - i) % 32;
+        __m256i counters = _mm256_setzero_si256();
+        for (; i < end; i += 32) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(text + i));
+            counters = _mm256_sub_epi8(counters, _mm256_cmpeq_epi8(v, match32));
+        }
+        __m256i sums = _mm256_sad_epu8(counters, _mm256_setzero_si256());
+        count += _mm256_extract_epi64(sums, 0) + _mm256_extract_epi64(sums, 1)
+               + _mm256_extract_epi64(sums, 2) + _mm256_extract_epi64(sums, 3);
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i match = _mm_set1_epi8(c);
+    while (i + 16 <= size) {
+        size_t end = size - i >= 255 * 16 ? i + 255 * 16 : size - (size - i) % 16;
+        __m128i counters = _mm_setzero_si128();
+        for (; i < end; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(text + i));
+            counters = _mm_sub_epi8(counters, _mm_cmpeq_epi8(v, match));
+        }
+        __m128i sums = _mm_sad_epu8(counters, _mm_setzero_si128());
+        count += _mm_cvtsi128_si32(sums) + _mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+    }
+#endif
+    for (; i < size; ++i) {
+        count += text[i] == c;
+    }
+    return count;
+}
@@ -1,8 +1,51 @@
-/* WCharacter.h - Character utility functions */
+/*
+  WCharacter.h - Character utility functions
+
+  Classification uses a 256-entry table of class bits built at compile
+  time for the "C" locale (ASCII only; bytes 128-255 belong to no class),
+  so each predicate is one table load and a mask instead of a call into
+  the locale-aware <ctype.h>. The table lives in program memory. Values
+  outside 0-255, such as -1 from Serial.read(), belong to no class.
+*/
 #ifndef WCharacter_h
 #define WCharacter_h
 
-#include <ctype.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Class bits
+#define CHAR_UPPER  0x01
+#define CHAR_LOWER  0x02
+#define CHAR_DIGIT  0x04
+#define CHAR_XDIGIT 0x08    // 0-9, A-F, a-f
+#define CHAR_SPACE  0x10    // ' ', \t, \n, \v, \f, \r
+#define CHAR_PUNCT  0x20
+#define CHAR_CNTRL  0x40
+#define CHAR_SP     0x80    // ' ' alone, the one printable non-graphic
+#define CHAR_ALPHA  (CHAR_UPPER | CHAR_LOWER)
+#define CHAR_ALNUM  (CHAR_ALPHA | CHAR_DIGIT)
+#define CHAR_GRAPH  (CHAR_ALNUM | CHAR_PUNCT)
+#define CHAR_PRINT  (CHAR_GRAPH | CHAR_SP)
+
+// Class bits of character c (0-255), evaluated at compile time to fill
+// characterClasses
+constexpr uint8_t characterClassOf(int c) {
+    return (c >= 'A' && c <= 'Z' ? CHAR_UPPER : 0)
+         | (c >= 'a' && c <= 'z' ? CHAR_LOWER : 0)
+         | (c >= '0' && c <= '9' ? CHAR_DIGIT | CHAR_XDIGIT : 0)
+         | ((c >= 'A' && c <= 'F') || (c >= 'a' && c <= 'f') ? CHAR_XDIGIT : 0)
+         | (c == ' ' || (c >= '\t' && c <= '\r') ? CHAR_SPACE : 0)
+         | (c > ' ' && c < 0x7F && !(c >= 'A' && c <= 'Z') && !(c >= 'a' && c <= 'z')
+                && !(c >= '0' && c <= '9') ? CHAR_PUNCT : 0)
+         | (c < ' ' || c == 0x7F ? CHAR_CNTRL : 0)
+         | (c == ' ' ? CHAR_SP : 0);
+}
+
+extern const uint8_t characterClasses[256] PROGMEM;
+
+inline uint8_t characterClass(int c) {
+    return (unsigned int)c < 256 ? pgm_read_byte(&characterClasses[c]) : 0;
+}
 
 // Character classification
 inline boolean isAlphaNumeric(int c) __attribute__((always_inline));
@@ -23,21 +66,52 @@ inline int toLowerCase(int c) __attribute__((always_inline));
 inline int toUpperCase(int c) __attribute__((always_inline));
 
 // Implementations
-inline boolean isAlphaNumeric(int c) { return (isalnum(c) == 0 ? false : true); }
-inline boolean isAlpha(int c) { return (isalpha(c) == 0 ? false : true); }
+inline boolean isAlphaNumeric(int c) { return (characterClass(c) & CHAR_ALNUM) != 0; }
+inline boolean isAlpha(int c) { return (characterClass(c) & CHAR_ALPHA) != 0; }
 inline boolean isAscii(int c) { return ((c & ~0x7F) == 0); }
-inline boolean isWhitespace(int c) { return (isspace(c) == 0 ? false : true); }
-inline boolean isControl(int c) { return (iscntrl(c) == 0 ? false : true); }
-inline boolean isDigit(int c) { return (isdigit(c) == 0 ? false : true); }
-inline boolean isGraph(int c) { return (isgraph(c) == 0 ? false : true); }
-inline boolean isLowerCase(int c) { return (islower(c) == 0 ? false : true); }
-inline boolean isPrintable(int c) { return (isprint(c) == 0 ? false : true); }
-inline boolean isPunct(int c) { return (ispunct(c) == 0 ? false : true); }
-inline boolean isSpace(int c) { return (isspace(c) == 0 ? false : true); }
-inline boolean isUpperCase(int c) { return (isupper(c) == 0 ? false : true); }
-inline boolean isHexadecimalDigit(int c) { return (isxdigit(c) == 0 ? false : true); }
+inline boolean isWhitespace(int c) { return (characterClass(c) & CHAR_SPACE) != 0; }
+inline boolean isControl(int c) { return (characterClass(c) & CHAR_CNTRL) != 0; }
+inline boolean isDigit(int c) { return (characterClass(c) & CHAR_DIGIT) != 0; }
+inline boolean isGraph(int c) { return (characterClass(c) & CHAR_GRAPH) != 0; }
+inline boolean isLowerCase(int c) { return (characterClass(c) & CHAR_LOWER) != 0; }
+inline boolean isPrintable(int c) { return (characterClass(c) & CHAR_PRINT) != 0; }
+inline boolean isPunct(int c) { return (characterClass(c) & CHAR_PUNCT) != 0; }
+inline boolean isSpace(int c) { return (characterClass(c) & CHAR_SPACE) != 0; }
+inline boolean isUpperCase(int c) { return (characterClass(c) & CHAR_UPPER) != 0; }
+inline boolean isHexadecimalDigit(int c) { return (characterClass(c) & CHAR_XDIGIT) != 0; }
 inline int toAscii(int c) { return (c & 0x7F); }
-inline int toLowerCase(int c) { return tolower(c); }
-inline int toUpperCase(int c) { return toupper(c); }
+inline int toLowerCase(int c) { return isUpperCase(c) ? c + ('a' - 'A') : c; }
+inline int toUpperCase(int c) { return isLowerCase(c) ? c - ('a' - 'A') : c; }
+
+// Bulk classification of size bytes of text. mask is any combination of
+// CHAR_* bits; a character matches if it has at least one of them.
+
+// Stores the class bits of every character in classes
+void classifyCharacters(const char *text, size_t size, uint8_t *classes);
+
+// Length of the leading run of characters that match mask
+size_t spanCharacters(const char *text, size_t size, uint8_t mask);
+
+// Length of the leading run of characters that do not match mask
+size_t spanCharactersNot(const char *text, size_t size, uint8_t mask);
+
+// Number of characters that match mask
+size_t countCharacters(const char *text, size_t size, uint8_t mask);
+
+// Whole-span operations, vectorized on host builds
+
+// Converts A-Z to a-z (resp. a-z to A-Z) in place
+void lowerCaseCharacters(char *text, size_t size);
+void upperCaseCharacters(char *text, size_t size);
+
+// Index of the first character that is not isPrintable(), size if none
+size_t findNonPrintable(const char *text, size_t size);
+
+// Number of bytes equal to c
+size_t countOccurrences(const char *text, size_t size, char c);
+
+inline size_t countNewlines(const char *text, size_t size) {
+    return countOccurrences(text, size, '\n');
+}
 
 #endif
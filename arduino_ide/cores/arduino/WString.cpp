@@ -0,0 +1,609 @@
+/*
+  WString.cpp - Arduino String with small-string optimization
+*/
+
+#include "Arduino.h"
+
+// StringPart
+
+StringPart::StringPart(const char *cstr) {
+    setText(cstr, cstr != NULL ? strlen(cstr) : 0);
+}
+
+StringPart::StringPart(const __FlashStringHelper *str) {
+    const char *p = (const char *)str;
+    _kind = FLASH;
+    _length = p != NULL ? strlen_P(p) : 0;
+    _value.text = p;
+}
+
+StringPart::StringPart(char c) {
+    _kind = CHARACTER;
+    _length = 1;
+    _value.character = c;
+}
+
+StringPart::StringPart(unsigned char value, unsigned char base) {
+    setNumber(value, base, false);
+}
+
+StringPart::StringPart(int value, unsigned char base) {
+    if (base == 10 && value < 0) {
+        setNumber(0U - (unsigned int)value, base, true);
+    } else {
+        setNumber((unsigned int)value, base, false);
+    }
+}
+
+StringPart::StringPart(unsigned int value, unsigned char base) {
+    setNumber(value, base, false);
+}
+
+StringPart::StringPart(long value, unsigned char base) {
+    if (base == 10 && value < 0) {
+        setNumber(0UL - (unsigned long)value, base, true);
+    } else {
+        setNumber((unsigned long)value, base, false);
+    }
+}
+
+StringPart::StringPart(unsigned long value, unsigned char base) {
+    setNumber(value, base, false);
+}
+
+StringPart::StringPart(float value, unsigned char decimalPlaces) {
+    setFloat(value, decimalPlaces);
+}
+
+StringPart::StringPart(double value, unsigned char decimalPlaces) {
+    setFloat(value, decimalPlaces);
+}
+
+void StringPart::setNumber(unsigned long value, unsigned char base, bool negative) {
+    if (base < 2 || base > 36) {
+        base = 10;
+    }
+    _kind = NUMBER;
+    _base = base;
+    _negative = negative;
+    _value.number = value;
+    _digits = numberLength(value, base);
+    _length = _digits + (negative ? 1 : 0);
+}
+
+void StringPart::setFloat(double value, unsigned char decimalPlaces) {
+    _kind = FLOAT;
+    _decimals = decimalPlaces;
+    floatDigitsSplit(value, decimalPlaces, _value.digits);
+    if (_value.digits.special != NULL) {
+        _length = strlen(_value.digits.special);
+        return;
+    }
+    _digits = numberLength(_value.digits.whole, 10);
+    _length = (_value.digits.negative ? 1 : 0) + _digits;
+    if (decimalPlaces > 0) {
+        _length += 1 + decimalPlaces;
+    }
+}
+
+char *StringPart::copyTo(char *dest) const {
+    switch (_kind) {
+    case TEXT:
+        // A null C string is empty, and memcpy() must not see it
+        if (_length != 0) {
+            memcpy(dest, _value.text, _length);
+        }
+        return dest + _length;
+    case FLASH:
+        memcpy_P(dest, _value.text, _length);
+        return dest + _length;
+    case CHARACTER:
+        *dest = _value.character;
+        return dest + 1;
+    case NUMBER:
+        if (_negative) {
+            *dest++ = '-';
+        }
+        numberFormat(dest, _value.number, _base, _digits);
+        if (_base > 10) {
+            for (uint8_t i = 0; i < _digits; ++i) {
+                if (dest[i] >= 'A') {
+                    dest[i] += 'a' - 'A';
+                }
+            }
+        }
+        return dest + _digits;
+    case FLOAT: {
+        const FloatDigits &digits = _value.digits;
+        if (digits.special != NULL) {
+            memcpy(dest, digits.special, _length);
+            return dest + _length;
+        }
+        if (digits.negative) {
+            *dest++ = '-';
+        }
+        numberFormat(dest, digits.whole, 10, _digits);
+        dest += _digits;
+        if (_decimals == 0) {
+            return dest;
+        }
+        *dest++ = '.';
+        numberFormat(dest, digits.fraction, 10, digits.fraction_digits);
+        dest += digits.fraction_digits;
+        double rest = digits.rest;
+        for (uint8_t i = digits.fraction_digits; i < _decimals; ++i) {
+            rest *= 10.0;
+            uint8_t digit = (uint8_t)rest;
+            rest -= digit;
+            *dest++ = '0' + digit;
+        }
+        return dest;
+    }
+    }
+    return dest;
+}
+
+// Construction and memory management
+
+void String::init(StringAllocator *allocator) {
+    _allocator = allocator;
+    _sso[0] = '\0';
+    _capacity = STRING_SSO_CAPACITY;
+    _len = 0;
+}
+
+void String::release(void) {
+    if (!isInline()) {
+        _allocator->release(_ptr, _capacity + 1);
+    }
+}
+
+// Takes rval's text, which must come from the same allocator or be
+// inline; rval is left empty
+void String::move(String &rval) {
+    if (rval.isInline()) {
+        memcpy(_sso, rval._sso, rval._len + 1);
+        _capacity = STRING_SSO_CAPACITY;
+    } else {
+        _ptr = rval._ptr;
+        _capacity = rval._capacity;
+    }
+    _len = rval._len;
+    rval.init(rval._allocator);
+}
+
+// Replaces the text with result's, built from this string's allocator
+// (or the heap, if that overflowed)
+void String::adopt(String &result) {
+    release();
+    _allocator = result._allocator;
+    move(result);
+}
+
+void String::assign(const char *cstr, unsigned int length) {
+    // reserve() cannot move the text if cstr points into it: such text
+    // is never longer than the current capacity
+    if (!reserve(length)) {
+        return;
+    }
+    memmove(buffer(), cstr, length);
+    _len = length;
+    buffer()[length] = '\0';
+}
+
+void String::assign(const StringPart &part) {
+    if (reserve(part.length())) {
+        char *end = part.copyTo(buffer());
+        _len = end - buffer();
+        *end = '\0';
+    }
+}
+
+String::String(const char *cstr) {
+    init(stringAllocator());
+    if (cstr != NULL) {
+        assign(cstr, strlen(cstr));
+    }
+}
+
+String::String(const char *cstr, unsigned int length) {
+    init(stringAllocator());
+    if (cstr != NULL) {
+        assign(cstr, length);
+    }
+}
+
+String::String(const String &str) {
+    init(stringAllocator());
+    assign(str.buffer(), str._len);
+}
+
+String::String(String &&rval) {
+    _allocator = rval._allocator;
+    move(rval);
+}
+
+String::String(StringAllocator *allocator) {
+    init(allocator);
+}
+
+String::String(const __FlashStringHelper *str) {
+    init(stringAllocator());
+    assign(StringPart(str));
+}
+
+String::String(char c) {
+    init(stringAllocator());
+    assign(StringPart(c));
+}
+
+String::String(unsigned char value, unsigned char base) {
+    init(stringAllocator());
+    assign(StringPart(value, base));
+}
+
+String::String(int value, unsigned char base) {
+    init(stringAllocator());
+    assign(StringPart(value, base));
+}
+
+String::String(unsigned int value, unsigned char base) {
+    init(stringAllocator());
+    assign(StringPart(value, base));
+}
+
+String::String(long value, unsigned char base) {
+    init(stringAllocator());
+    assign(StringPart(value, base));
+}
+
+String::String(unsigned long value, unsigned char base) {
+    init(stringAllocator());
+    assign(StringPart(value, base));
+}
+
+String::String(float value, unsigned char decimalPlaces) {
+    init(stringAllocator());
+    assign(StringPart(value, decimalPlaces));
+}
+
+String::String(double value, unsigned char decimalPlaces) {
+    init(stringAllocator());
+    assign(StringPart(value, decimalPlaces));
+}
+
+String::~String(void) {
+    release();
+}
+
+unsigned char String::reserve(unsigned int size) {
+    if (size <= _capacity) {
+        return 1;
+    }
+    if (growInPlace(size)) {
+        return 1;
+    }
+    StringAllocator *from = _allocator;
+    char *grown = (char *)from->allocate(size + 1);
+    if (grown == NULL && from != &stringHeap) {
+        // The pool or arena is exhausted; this string continues on the heap
+        from->noteOverflow();
+        grown = (char *)stringHeap.allocate(size + 1);
+        if (grown != NULL) {
+            _allocator = &stringHeap;
+        }
+    }
+    if (grown == NULL) {
+        return 0;
+    }
+    memcpy(grown, buffer(), _len + 1);
+    if (!isInline()) {
+        from->release(_ptr, _capacity + 1);
+    }
+    _ptr = grown;
+    _capacity = size;
+    return 1;
+}
+
+String &String::operator=(const String &rhs) {
+    if (this != &rhs) {
+        assign(rhs.buffer(), rhs._len);
+    }
+    return *this;
+}
+
+String &String::operator=(String &&rval) {
+    if (this == &rval) {
+        return *this;
+    }
+    if (rval.isInline() || rval._allocator == _allocator) {
+        release();
+        move(rval);
+    } else {
+        // The buffer may not live as long as this string: copy the text
+        assign(rval.buffer(), rval._len);
+    }
+    return *this;
+}
+
+String &String::operator=(const char *cstr) {
+    if (cstr != NULL) {
+        assign(cstr, strlen(cstr));
+    } else {
+        _len = 0;
+        buffer()[0] = '\0';
+    }
+    return *this;
+}
+
+String &String::operator=(const __FlashStringHelper *str) {
+    _len = 0;
+    assign(StringPart(str));
+    return *this;
+}
+
+// Comparison
+
+int String::compareTo(const String &s) const {
+    return strcmp(buffer(), s.buffer());
+}
+
+unsigned char String::equals(const String &s) const {
+    return _len == s._len && memcmp(buffer(), s.buffer(), _len) == 0;
+}
+
+unsigned char String::equals(const char *cstr) const {
+    if (cstr == NULL) {
+        return _len == 0;
+    }
+    return strcmp(buffer(), cstr) == 0;
+}
+
+unsigned char String::equalsIgnoreCase(const String &s) const {
+    if (_len != s._len) {
+        return 0;
+    }
+    const char *a = buffer();
+    const char *b = s.buffer();
+    for (unsigned int i = 0; i < _len; ++i) {
+        if (::toLowerCase((unsigned char)a[i]) != ::toLowerCase((unsigned char)b[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+unsigned char String::startsWith(const String &prefix) const {
+    return startsWith(prefix, 0);
+}
+
+unsigned char String::startsWith(const String &prefix, unsigned int offset) const {
+    if (offset > _len || prefix._len > _len - offset) {
+        return 0;
+    }
+    return memcmp(buffer() + offset, prefix.buffer(), prefix._len) == 0;
+}
+
+unsigned char String::endsWith(const String &suffix) const {
+    if (suffix._len > _len) {
+        return 0;
+    }
+    return memcmp(buffer() + _len - suffix._len, suffix.buffer(), suffix._len) == 0;
+}
+
+// Character access
+
+char String::charAt(unsigned int index) const {
+    return operator[](index);
+}
+
+void String::setCharAt(unsigned int index, char c) {
+    if (index < _len) {
+        buffer()[index] = c;
+    }
+}
+
+char String::operator[](unsigned int index) const {
+    return index < _len ? buffer()[index] : 0;
+}
+
+char &String::operator[](unsigned int index) {
+    static char dummy_writable_char;
+    if (index >= _len) {
+        dummy_writable_char = 0;
+        return dummy_writable_char;
+    }
+    return buffer()[index];
+}
+
+void String::getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index) const {
+    if (bufsize == 0 || buf == NULL) {
+        return;
+    }
+    if (index >= _len) {
+        buf[0] = 0;
+        return;
+    }
+    unsigned int n = bufsize - 1;
+    if (n > _len - index) {
+        n = _len - index;
+    }
+    memcpy(buf, buffer() + index, n);
+    buf[n] = 0;
+}
+
+// Search
+
+int String::indexOf(char ch, unsigned int fromIndex) const {
+    if (fromIndex >= _len) {
+        return -1;
+    }
+    const char *found = (const char *)memchr(buffer() + fromIndex, ch, _len - fromIndex);
+    return found != NULL ? (int)(found - buffer()) : -1;
+}
+
+int String::indexOf(const String &str, unsigned int fromIndex) const {
+    if (fromIndex >= _len) {
+        return -1;
+    }
+    const char *found = strstr(buffer() + fromIndex, str.buffer());
+    return found != NULL ? (int)(found - buffer()) : -1;
+}
+
+int String::lastIndexOf(char ch, unsigned int fromIndex) const {
+    if (fromIndex >= _len) {
+        return -1;
+    }
+    const char *text = buffer();
+    for (int i = (int)fromIndex; i >= 0; --i) {
+        if (text[i] == ch) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int String::lastIndexOf(const String &str, unsigned int fromIndex) const {
+    if (str._len == 0 || _len == 0 || str._len > _len) {
+        return -1;
+    }
+    if (fromIndex > _len - str._len) {
+        fromIndex = _len - str._len;
+    }
+    const char *text = buffer();
+    for (int i = (int)fromIndex; i >= 0; --i) {
+        if (memcmp(text + i, str.buffer(), str._len) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+String String::substring(unsigned int left, unsigned int right) const {
+    if (left > right) {
+        unsigned int temp = right;
+        right = left;
+        left = temp;
+    }
+    if (left >= _len) {
+        return String();
+    }
+    if (right > _len) {
+        right = _len;
+    }
+    return String(buffer() + left, right - left);
+}
+
+// Modification
+
+void String::replace(char find, char replace) {
+    char *text = buffer();
+    for (unsigned int i = 0; i < _len; ++i) {
+        if (text[i] == find) {
+            text[i] = replace;
+        }
+    }
+}
+
+void String::replace(const String &find, const String &replace) {
+    if (_len == 0 || find._len == 0) {
+        return;
+    }
+    const char *text = buffer();
+    unsigned int count = 0;
+    for (const char *p = text; (p = strstr(p, find.buffer())) != NULL; p += find._len) {
+        count++;
+    }
+    if (count == 0) {
+        return;
+    }
+    if (replace._len <= find._len) {
+        // Shrinks or keeps the length: compact in place, front to back
+        char *out = buffer();
+        const char *in = out;
+        const char *match;
+        while ((match = strstr(in, find.buffer())) != NULL) {
+            memmove(out, in, match - in);
+            out += match - in;
+            memcpy(out, replace.buffer(), replace._len);
+            out += replace._len;
+            in = match + find._len;
+        }
+        unsigned int tail = buffer() + _len - in;
+        memmove(out, in, tail);
+        out += tail;
+        *out = '\0';
+        _len = out - buffer();
+        return;
+    }
+    // Grows: one pass into a new buffer of the final size
+    String result(_allocator);
+    if (!result.reserve(_len + count * (replace._len - find._len))) {
+        return;
+    }
+    const char *in = text;
+    const char *match;
+    while ((match = strstr(in, find.buffer())) != NULL) {
+        result.concat(in, match - in);
+        result.concat(replace);
+        in = match + find._len;
+    }
+    result.concat(in, text + _len - in);
+    adopt(result);
+}
+
+void String::remove(unsigned int index) {
+    remove(index, (unsigned int)-1);
+}
+
+void String::remove(unsigned int index, unsigned int count) {
+    if (index >= _len || count == 0) {
+        return;
+    }
+    if (count > _len - index) {
+        count = _len - index;
+    }
+    char *text = buffer();
+    memmove(text + index, text + index + count, _len - index - count + 1);
+    _len -= count;
+}
+
+void String::toLowerCase(void) {
+    lowerCaseCharacters(buffer(), _len);
+}
+
+void String::toUpperCase(void) {
+    upperCaseCharacters(buffer(), _len);
+}
+
+void String::trim(void) {
+    if (_len == 0) {
+        return;
+    }
+    char *text = buffer();
+    unsigned int first = 0;
+    while (first < _len && isSpace((unsigned char)text[first])) {
+        first++;
+    }
+    unsigned int last = _len;
+    while (last > first && isSpace((unsigned char)text[last - 1])) {
+        last--;
+    }
+    _len = last - first;
+    memmove(text, text + first, _len);
+    text[_len] = '\0';
+}
+
+// Parsing
+
+long String::toInt(void) const {
+    return atol(buffer());
+}
+
+float String::toFloat(void) const {
+    return (float)atof(buffer());
+}
+
+double String::toDouble(void) const {
+    return atof(buffer());
+}
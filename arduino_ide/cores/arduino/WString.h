@@ -1,37 +1,390 @@
-/* WString.h - String class stub */
+/*
+  WString.h - Arduino String with small-string optimization
+
+  Strings of up to STRING_SSO_CAPACITY characters are stored inside the
+  object; longer ones move to the heap, which grows geometrically so a
+  run of += costs O(log n) allocations. reserve() sizes the buffer up
+  front. Strings are movable, so returning one never copies its text.
+
+  a + b + c builds a StringConcat, a lightweight list of the operands,
+  and only the final conversion to String allocates, once, at the total
+  length. Operands may be Strings, C strings, F() strings, characters and
+  numbers, as with Arduino's StringSumHelper. Like that class, the
+  expression can also be used as a String, e.g. (a + b).c_str() or
+  a + b == "x"; the String is then built on first use. A StringConcat
+  refers to its String operands, so it must be consumed within the same
+  statement.
+
+  Buffers come from the String's allocator (StringAllocator.h), chosen
+  when the String is created.
+*/
+
 #ifndef WString_h
 #define WString_h
 
 #include <stdlib.h>
 #include <string.h>
+#include "NumberFormat.h"
+#include "StringAllocator.h"
+
+// Characters stored inline, not counting the terminator
+#if !defined(STRING_SSO_CAPACITY)
+#if defined(__AVR__)
+#define STRING_SSO_CAPACITY 7
+#else
+#define STRING_SSO_CAPACITY 15
+#endif
+#endif
 
 class String;
 
 class __FlashStringHelper;
 #define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(PSTR(string_literal)))
 
-// Minimal String class stub for compilation
+// One operand of a concatenation: text to copy, or a value to format.
+// Numbers follow String's constructors: lowercase digits, and a sign
+// only in base 10.
+class StringPart {
+public:
+    StringPart(const String &str);
+    StringPart(const char *cstr);
+    StringPart(const char *text, unsigned int length) { setText(text, length); }
+    StringPart(const __FlashStringHelper *str);
+    StringPart(char c);
+    StringPart(unsigned char value, unsigned char base = 10);
+    StringPart(int value, unsigned char base = 10);
+    StringPart(unsigned int value, unsigned char base = 10);
+    StringPart(long value, unsigned char base = 10);
+    StringPart(unsigned long value, unsigned char base = 10);
+    StringPart(float value, unsigned char decimalPlaces = 2);
+    StringPart(double value, unsigned char decimalPlaces = 2);
+
+    unsigned int length(void) const { return _length; }
+
+    // Writes the text (no terminator) and returns the end of it
+    char *copyTo(char *dest) const;
+
+private:
+    enum Kind { TEXT, FLASH, CHARACTER, NUMBER, FLOAT };
+
+    void setText(const char *text, unsigned int length) {
+        _kind = TEXT;
+        _length = length;
+        _value.text = text;
+    }
+    void setNumber(unsigned long value, unsigned char base, bool negative);
+    void setFloat(double value, unsigned char decimalPlaces);
+
+    uint8_t _kind;
+    uint8_t _base;              // NUMBER
+    uint8_t _decimals;          // FLOAT
+    uint8_t _digits;            // NUMBER digits, or FLOAT integer digits
+    bool _negative;
+    unsigned int _length;
+    union {
+        const char *text;
+        char character;
+        unsigned long number;
+        FloatDigits digits;
+    } _value;
+};
+
+template <typename L, typename R>
+class StringConcat;
+
 class String {
 public:
-    String(const char *cstr = "") {}
-    String(const String &str) {}
-    String(const __FlashStringHelper *str) {}
-    ~String(void) {}
+    String(const char *cstr = "");
+    String(const char *cstr, unsigned int length);
+    String(const String &str);
+    String(String &&rval);
+    String(const __FlashStringHelper *str);
+    explicit String(char c);
+    explicit String(unsigned char value, unsigned char base = 10);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(float value, unsigned char decimalPlaces = 2);
+    explicit String(double value, unsigned char decimalPlaces = 2);
+    template <typename L, typename R>
+    String(const StringConcat<L, R> &expr) { init(stringAllocator()); assign(expr); }
+    // An empty string whose buffers come from allocator
+    explicit String(StringAllocator *allocator);
+    ~String(void);
+
+    // Memory management. Returns false (0) if the buffer cannot grow.
+    unsigned char reserve(unsigned int size);
+    unsigned int length(void) const { return _len; }
+    unsigned int capacity(void) const { return _capacity; }
+    StringAllocator *allocator(void) const { return _allocator; }
+
+    String &operator=(const String &rhs);
+    String &operator=(String &&rval);
+    String &operator=(const char *cstr);
+    String &operator=(const __FlashStringHelper *str);
+    template <typename L, typename R>
+    String &operator=(const StringConcat<L, R> &expr) {
+        // The operands may refer to this string, so build a new one
+        String result(_allocator);
+        result.assign(expr);
+        adopt(result);
+        return *this;
+    }
+
+    // Appending anything StringPart takes, including Strings. concat()
+    // returns false (0) if memory runs out.
+    unsigned char concat(const char *cstr) { return append(StringPart(cstr)); }
+    unsigned char concat(const char *cstr, unsigned int length) { return append(StringPart(cstr, length)); }
+    unsigned char concat(const uint8_t *data, unsigned int length) { return concat((const char *)data, length); }
+    unsigned char concat(const StringPart &part) { return append(part); }
+    // Numbers and characters, spelled out so a literal 0 is not taken
+    // for a null C string
+    unsigned char concat(char c) { return append(StringPart(c)); }
+    unsigned char concat(unsigned char num) { return append(StringPart(num)); }
+    unsigned char concat(int num) { return append(StringPart(num)); }
+    unsigned char concat(unsigned int num) { return append(StringPart(num)); }
+    unsigned char concat(long num) { return append(StringPart(num)); }
+    unsigned char concat(unsigned long num) { return append(StringPart(num)); }
+    unsigned char concat(float num) { return append(StringPart(num)); }
+    unsigned char concat(double num) { return append(StringPart(num)); }
+    template <typename L, typename R>
+    unsigned char concat(const StringConcat<L, R> &expr) { return append(expr); }
+
+    String &operator+=(const char *cstr) { concat(cstr); return *this; }
+    String &operator+=(const StringPart &part) { concat(part); return *this; }
+    String &operator+=(char c) { concat(c); return *this; }
+    String &operator+=(unsigned char num) { concat(num); return *this; }
+    String &operator+=(int num) { concat(num); return *this; }
+    String &operator+=(unsigned int num) { concat(num); return *this; }
+    String &operator+=(long num) { concat(num); return *this; }
+    String &operator+=(unsigned long num) { concat(num); return *this; }
+    String &operator+=(float num) { concat(num); return *this; }
+    String &operator+=(double num) { concat(num); return *this; }
+    template <typename L, typename R>
+    String &operator+=(const StringConcat<L, R> &expr) { concat(expr); return *this; }
+
+    explicit operator bool() const { return true; }
+
+    // Comparison
+    int compareTo(const String &s) const;
+    unsigned char equals(const String &s) const;
+    unsigned char equals(const char *cstr) const;
+    unsigned char equalsIgnoreCase(const String &s) const;
+    unsigned char startsWith(const String &prefix) const;
+    unsigned char startsWith(const String &prefix, unsigned int offset) const;
+    unsigned char endsWith(const String &suffix) const;
+
+    unsigned char operator==(const String &rhs) const { return equals(rhs); }
+    unsigned char operator==(const char *cstr) const { return equals(cstr); }
+    unsigned char operator!=(const String &rhs) const { return !equals(rhs); }
+    unsigned char operator!=(const char *cstr) const { return !equals(cstr); }
+    unsigned char operator<(const String &rhs) const { return compareTo(rhs) < 0; }
+    unsigned char operator>(const String &rhs) const { return compareTo(rhs) > 0; }
+    unsigned char operator<=(const String &rhs) const { return compareTo(rhs) <= 0; }
+    unsigned char operator>=(const String &rhs) const { return compareTo(rhs) >= 0; }
+
+    // Character access
+    char charAt(unsigned int index) const;
+    void setCharAt(unsigned int index, char c);
+    char operator[](unsigned int index) const;
+    char &operator[](unsigned int index);
+    void getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index = 0) const;
+    void toCharArray(char *buf, unsigned int bufsize, unsigned int index = 0) const {
+        getBytes((unsigned char *)buf, bufsize, index);
+    }
+    const char *c_str() const { return buffer(); }
+    char *begin() { return buffer(); }
+    char *end() { return buffer() + _len; }
+    const char *begin() const { return buffer(); }
+    const char *end() const { return buffer() + _len; }
+
+    // Search
+    int indexOf(char ch) const { return indexOf(ch, 0); }
+    int indexOf(char ch, unsigned int fromIndex) const;
+    int indexOf(const String &str) const { return indexOf(str, 0); }
+    int indexOf(const String &str, unsigned int fromIndex) const;
+    int lastIndexOf(char ch) const { return lastIndexOf(ch, _len - 1); }
+    int lastIndexOf(char ch, unsigned int fromIndex) const;
+    int lastIndexOf(const String &str) const { return lastIndexOf(str, _len - str._len); }
+    int lastIndexOf(const String &str, unsigned int fromIndex) const;
+    String substring(unsigned int beginIndex) const { return substring(beginIndex, _len); }
+    String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+    // Modification
+    void replace(char find, char replace);
+    void replace(const String &find, const String &replace);
+    void remove(unsigned int index);
+    void remove(unsigned int index, unsigned int count);
+    void toLowerCase(void);
+    void toUpperCase(void);
+    void trim(void);
+
+    // Parsing
+    long toInt(void) const;
+    float toFloat(void) const;
+    double toDouble(void) const;
+
+private:
+    bool isInline() const { return _capacity <= STRING_SSO_CAPACITY; }
+    char *buffer() { return isInline() ? _sso : _ptr; }
+    const char *buffer() const { return isInline() ? _sso : _ptr; }
+
+    void init(StringAllocator *allocator);
+    void release(void);
+    void move(String &rval);
+    void adopt(String &result);
+    void assign(const char *cstr, unsigned int length);
+    void assign(const StringPart &part);
+    template <typename L, typename R>
+    void assign(const StringConcat<L, R> &expr) {
+        if (reserve(expr.length())) {
+            char *end = expr.copyTo(buffer());
+            _len = end - buffer();
+            *end = '\0';
+        }
+    }
+    bool growInPlace(unsigned int size) {
+        if (isInline() || !_allocator->resize(_ptr, _capacity + 1, size + 1)) {
+            return false;
+        }
+        _capacity = size;
+        return true;
+    }
+    unsigned int nextCapacity(unsigned int size) const {
+        unsigned int grown = _capacity + _capacity / 2;
+        return size > grown ? size : grown;
+    }
+
+    // Appends anything with length() and copyTo(). The operands may point
+    // into this string, so unless the allocator can grow the buffer in
+    // place the result is built in a new one before the old one is released.
+    template <typename Expr>
+    unsigned char append(const Expr &expr) {
+        unsigned int size = _len + expr.length();
+        if (size > _capacity && !growInPlace(nextCapacity(size))) {
+            String result(_allocator);
+            if (!result.reserve(nextCapacity(size))) {
+                return 0;
+            }
+            memcpy(result.buffer(), buffer(), _len);
+            result._len = _len;
+            result.append(expr);
+            adopt(result);
+            return 1;
+        }
+        char *end = expr.copyTo(buffer() + _len);
+        _len = end - buffer();
+        *end = '\0';
+        return 1;
+    }
+
+    union {
+        char *_ptr;
+        char _sso[STRING_SSO_CAPACITY + 1];
+    };
+    unsigned int _capacity;
+    unsigned int _len;
+    StringAllocator *_allocator;
+};
+
+inline StringPart::StringPart(const String &str) { setText(str.c_str(), str.length()); }
+
+// Built by operator+. Converting it to a String formats every operand
+// straight into one buffer of the total length. Used in place of a String
+// (a.c_str(), a == "x", a.indexOf(...)), like Arduino's StringSumHelper,
+// it builds that String on first use and keeps it until the end of the
+// statement.
+template <typename L, typename R>
+class StringConcat {
+public:
+    StringConcat(const L &left, const R &right)
+        : _left(left), _right(right), _length(left.length() + right.length()), _built(false) {}
+
+    unsigned int length(void) const { return _length; }
+    char *copyTo(char *dest) const { return _right.copyTo(_left.copyTo(dest)); }
+
+    const String &str(void) const {
+        if (!_built) {
+            _text = *this;
+            _built = true;
+        }
+        return _text;
+    }
+
+    explicit operator bool() const { return true; }
+
+    int compareTo(const String &s) const { return str().compareTo(s); }
+    unsigned char equals(const String &s) const { return str().equals(s); }
+    unsigned char equals(const char *cstr) const { return str().equals(cstr); }
+    unsigned char equalsIgnoreCase(const String &s) const { return str().equalsIgnoreCase(s); }
+    unsigned char startsWith(const String &prefix) const { return str().startsWith(prefix); }
+    unsigned char startsWith(const String &prefix, unsigned int offset) const { return str().startsWith(prefix, offset); }
+    unsigned char endsWith(const String &suffix) const { return str().endsWith(suffix); }
 
-    unsigned int length(void) const { return 0; }
-    char charAt(unsigned int index) const { return 0; }
-    void setCharAt(unsigned int index, char c) {}
-    char operator [] (unsigned int index) const { return 0; }
-    char& operator [] (unsigned int index) { static char c; return c; }
+    unsigned char operator==(const String &rhs) const { return str() == rhs; }
+    unsigned char operator==(const char *cstr) const { return str() == cstr; }
+    unsigned char operator!=(const String &rhs) const { return str() != rhs; }
+    unsigned char operator!=(const char *cstr) const { return str() != cstr; }
+    unsigned char operator<(const String &rhs) const { return str() < rhs; }
+    unsigned char operator>(const String &rhs) const { return str() > rhs; }
+    unsigned char operator<=(const String &rhs) const { return str() <= rhs; }
+    unsigned char operator>=(const String &rhs) const { return str() >= rhs; }
 
-    bool operator == (const String &rhs) const { return false; }
-    bool operator != (const String &rhs) const { return true; }
+    char charAt(unsigned int index) const { return str().charAt(index); }
+    char operator[](unsigned int index) const { return str()[index]; }
+    void getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index = 0) const {
+        str().getBytes(buf, bufsize, index);
+    }
+    void toCharArray(char *buf, unsigned int bufsize, unsigned int index = 0) const {
+        str().toCharArray(buf, bufsize, index);
+    }
+    const char *c_str() const { return str().c_str(); }
+    const char *begin() const { return str().begin(); }
+    const char *end() const { return str().end(); }
 
-    String & operator = (const String &rhs) { return *this; }
-    String & operator += (const String &rhs) { return *this; }
-    String operator + (const String &rhs) { return *this; }
+    int indexOf(char ch) const { return str().indexOf(ch); }
+    int indexOf(char ch, unsigned int fromIndex) const { return str().indexOf(ch, fromIndex); }
+    int indexOf(const String &s) const { return str().indexOf(s); }
+    int indexOf(const String &s, unsigned int fromIndex) const { return str().indexOf(s, fromIndex); }
+    int lastIndexOf(char ch) const { return str().lastIndexOf(ch); }
+    int lastIndexOf(char ch, unsigned int fromIndex) const { return str().lastIndexOf(ch, fromIndex); }
+    int lastIndexOf(const String &s) const { return str().lastIndexOf(s); }
+    int lastIndexOf(const String &s, unsigned int fromIndex) const { return str().lastIndexOf(s, fromIndex); }
+    String substring(unsigned int beginIndex) const { return str().substring(beginIndex); }
+    String substring(unsigned int beginIndex, unsigned int endIndex) const {
+        return str().substring(beginIndex, endIndex);
+    }
 
-    const char * c_str() const { return ""; }
+    long toInt(void) const { return str().toInt(); }
+    float toFloat(void) const { return str().toFloat(); }
+    double toDouble(void) const { return str().toDouble(); }
+
+private:
+    L _left;
+    R _right;
+    unsigned int _length;
+    mutable bool _built;
+    mutable String _text;
 };
 
+// Concatenation operators. The left operand must be a String, a C string,
+// an F() string or a concatenation; the right one anything StringPart takes.
+inline StringConcat<StringPart, StringPart> operator+(const String &lhs, const StringPart &rhs) {
+    return StringConcat<StringPart, StringPart>(lhs, rhs);
+}
+
+inline StringConcat<StringPart, StringPart> operator+(const char *lhs, const String &rhs) {
+    return StringConcat<StringPart, StringPart>(lhs, rhs);
+}
+
+inline StringConcat<StringPart, StringPart> operator+(const __FlashStringHelper *lhs, const String &rhs) {
+    return StringConcat<StringPart, StringPart>(lhs, rhs);
+}
+
+template <typename L, typename R>
+inline StringConcat<StringConcat<L, R>, StringPart> operator+(const StringConcat<L, R> &lhs, const StringPart &rhs) {
+    return StringConcat<StringConcat<L, R>, StringPart>(lhs, rhs);
+}
+
 #endif
@@ -0,0 +1,66 @@
+/*
+  pins_arduino.h - Pin definitions for the Arduino Uno (ATmega328P)
+
+  Digital pins 0-7 are PORTD, 8-13 are PORTB and 14-19 (A0-A5) are PORTC.
+  The lookup tables cover every uint8_t pin number; numbers without a
+  physical pin map to a zero bit mask, so a write to them is a no-op and
+  a read returns LOW without any range check.
+
+  Six pins have a PWM output: 5 and 6 on Timer0, 9 and 10 on Timer1,
+  3 and 11 on Timer2. Pins 2 and 3 carry the external interrupts INT0
+  and INT1.
+*/
+
+#ifndef Pins_Arduino_h
+#define Pins_Arduino_h
+
+#define NUM_DIGITAL_PINS  20
+#define NUM_ANALOG_INPUTS 6
+
+// Port indices into the pin store (see SimPins.h)
+#define PB 0
+#define PC 1
+#define PD 2
+#define NUM_PORTS 3
+
+// Rules the tables are built from, usable in constant expressions
+#define PIN_TO_PORT_RULE(P) \
+    ((P) < 8 ? PD : (P) < 14 ? PB : (P) < NUM_DIGITAL_PINS ? PC : PB)
+#define PIN_TO_BIT_MASK_RULE(P) \
+    ((P) < 8 ? (1 << (P)) : (P) < 14 ? (1 << ((P) - 8)) : (P) < NUM_DIGITAL_PINS ? (1 << ((P) - 14)) : 0)
+
+// Timer outputs behind analogWrite(), numbered from 1 (see SimPwm.h)
+#define NOT_ON_TIMER 0
+#define TIMER0A 1
+#define TIMER0B 2
+#define TIMER1A 3
+#define TIMER1B 4
+#define TIMER2A 5
+#define TIMER2B 6
+#define NUM_TIMER_OUTPUTS 6
+
+#define PIN_TO_TIMER_RULE(P) \
+    ((P) == 6 ? TIMER0A : (P) == 5 ? TIMER0B : (P) == 9 ? TIMER1A : \
+     (P) == 10 ? TIMER1B : (P) == 11 ? TIMER2A : (P) == 3 ? TIMER2B : NOT_ON_TIMER)
+
+#define EXTERNAL_NUM_INTERRUPTS 2
+#define NOT_AN_INTERRUPT -1
+#define digitalPinToInterrupt(P) ((P) == 2 ? 0 : ((P) == 3 ? 1 : NOT_AN_INTERRUPT))
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern const uint8_t digital_pin_to_port_PGM[256] PROGMEM;
+extern const uint8_t digital_pin_to_bit_mask_PGM[256] PROGMEM;
+extern const uint8_t digital_pin_to_timer_PGM[256] PROGMEM;
+
+#ifdef __cplusplus
+}
+#endif
+
+#define digitalPinToPort(P) (pgm_read_byte(digital_pin_to_port_PGM + (uint8_t)(P)))
+#define digitalPinToBitMask(P) (pgm_read_byte(digital_pin_to_bit_mask_PGM + (uint8_t)(P)))
+#define digitalPinToTimer(P) (pgm_read_byte(digital_pin_to_timer_PGM + (uint8_t)(P)))
+
+#endif
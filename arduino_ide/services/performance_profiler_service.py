@@ -24,6 +24,8 @@ import time
 
 from PySide6.QtCore import QObject, Signal, QProcess
 
+from arduino_ide.services.simulated_ports import run_announcing_ports
+
 
 class ProfileMode(Enum):
     """Profiling mode"""
@@ -142,6 +144,8 @@ class PerformanceProfilerService(QObject):
         function_profiled: Emitted when a function is profiled
         memory_snapshot_taken: Emitted when memory snapshot is captured
         bottleneck_detected: Emitted when bottleneck is detected
+        simulated_port_announced: Emitted when the profiled sketch opens a
+            simulated serial port
     """
 
     # Signals
@@ -150,6 +154,7 @@ class PerformanceProfilerService(QObject):
     function_profiled = Signal(FunctionProfile)
     memory_snapshot_taken = Signal(MemorySnapshot)
     bottleneck_detected = Signal(Bottleneck)
+    simulated_port_announced = Signal(str)  # device path
 
     def __init__(self, project_path: str = "", arduino_cli_path: str = "arduino-cli"):
         super().__init__()
@@ -247,11 +252,11 @@ class PerformanceProfilerService(QObject):
                 timeout=60
             )
 
-            # Run with profiling
-            subprocess.run(
+            # Run with profiling; its simulated Serial is offered while it runs
+            run_announcing_ports(
                 [str(build_dir / "profile_exe")],
+                self.simulated_port_announced.emit,
                 cwd=str(build_dir),
-                capture_output=True,
                 timeout=30
             )
 
@@ -0,0 +1,108 @@
+"""Ports announced by sketches running on the host-simulated core.
+
+With ``ARDUINO_SERIAL=pty`` a host build prints the pseudo-terminal behind
+its ``Serial`` on stderr, e.g. ``Serial: pty /dev/pts/3``. The device only
+exists while the sketch runs, so the services that run host builds (the
+profiler and the unit-test runner) scan stderr as it arrives and emit
+``simulated_port_announced`` for each line; the main window offers the
+device in the Serial Monitor, which in turn feeds the plotter and the power
+analyzer.
+"""
+
+from __future__ import annotations
+
+import re
+import subprocess
+import threading
+from typing import Callable, List, Optional, Sequence
+
+SIMULATED_PORT_PATTERN = re.compile(r"^Serial: pty (\S+)")
+
+
+def parse_simulated_port(line: str) -> Optional[str]:
+    """Return the port path announced by a simulated board, or None."""
+    match = SIMULATED_PORT_PATTERN.match(line.strip())
+    return match.group(1) if match else None
+
+
+def find_simulated_ports(text: str) -> List[str]:
+    """Return every port announced in a chunk of stderr output, in order."""
+    ports = []
+    for line in text.splitlines():
+        device = parse_simulated_port(line)
+        if device is not None:
+            ports.append(device)
+    return ports
+
+
+class SimulatedPortScanner:
+    """Calls ``on_port`` for each port announced in a stream of stderr.
+
+    Chunks may end mid-line (QProcess hands over whatever is readable), so
+    the unfinished tail is kept until its newline arrives.
+    """
+
+    def __init__(self, on_port: Callable[[str], None]):
+        self.on_port = on_port
+        self._partial = ""
+
+    def reset(self):
+        """Forget any unfinished line, e.g. before a new process starts."""
+        self._partial = ""
+
+    def feed(self, text: str):
+        """Scan the next chunk of stderr."""
+        lines = (self._partial + text).split("\n")
+        self._partial = lines.pop()
+        for device in find_simulated_ports("\n".join(lines)):
+            self.on_port(device)
+
+    def finish(self):
+        """Scan a last line that ended without a newline."""
+        partial, self._partial = self._partial, ""
+        for device in find_simulated_ports(partial):
+            self.on_port(device)
+
+
+def run_announcing_ports(args: Sequence[str], on_port: Callable[[str], None],
+                         timeout: Optional[float] = None,
+                         **kwargs) -> subprocess.CompletedProcess:
+    """Run a host build like ``subprocess.run(capture_output=True, text=True)``.
+
+    Unlike subprocess.run, stderr is scanned while the process runs, so
+    ``on_port`` sees each announced device while it still exists. Raises
+    subprocess.TimeoutExpired once the process is killed after ``timeout``.
+    """
+    process = subprocess.Popen(args, stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+                               text=True, **kwargs)
+    stdout: List[str] = []
+    reader = threading.Thread(target=lambda: stdout.append(process.stdout.read()), daemon=True)
+    reader.start()
+    timed_out = threading.Event()
+
+    def kill():
+        timed_out.set()
+        process.kill()
+
+    timer = threading.Timer(timeout, kill) if timeout is not None else None
+    if timer is not None:
+        timer.start()
+
+    scanner = SimulatedPortScanner(on_port)
+    stderr: List[str] = []
+    try:
+        for line in process.stderr:
+            stderr.append(line)
+            scanner.feed(line)
+        scanner.finish()
+        returncode = process.wait()
+        reader.join()
+    finally:
+        if timer is not None:
+            timer.cancel()
+        process.stdout.close()
+        process.stderr.close()
+
+    if timed_out.is_set():
+        raise subprocess.TimeoutExpired(list(args), timeout, "".join(stdout), "".join(stderr))
+    return subprocess.CompletedProcess(list(args), returncode, "".join(stdout), "".join(stderr))
@@ -0,0 +1,131 @@
+"""Decoder for the binary telemetry frames sent by ``Telemetry.h`` sketches.
+
+Frame layout (all fields little endian)::
+
+    A5 5A | length:u16 | type:u8 | channels:u8 | seq:u8 | samples | crc:u16
+
+The CRC is CRC-16/CCITT-FALSE over everything between the sync bytes and
+the CRC itself. Frames are located and validated in place: the receive
+buffer is only ever appended to and trimmed, samples are unpacked straight
+from it with precompiled ``struct`` formats, and the CRC is computed over a
+memoryview, so no per-frame copies are made.
+"""
+
+from __future__ import annotations
+
+import binascii
+import struct
+from dataclasses import dataclass
+from typing import Dict, List, Tuple
+
+SYNC = b"\xa5\x5a"
+HEADER = struct.Struct("<2sHBBB")
+CRC = struct.Struct("<H")
+
+TELEMETRY_UINT8 = 1
+TELEMETRY_INT16 = 2
+TELEMETRY_INT32 = 3
+TELEMETRY_FLOAT32 = 4
+
+SAMPLE_FORMATS = {
+    TELEMETRY_UINT8: "B",
+    TELEMETRY_INT16: "h",
+    TELEMETRY_INT32: "i",
+    TELEMETRY_FLOAT32: "f",
+}
+
+SAMPLE_SIZES = {sample_type: struct.calcsize(fmt) for sample_type, fmt in SAMPLE_FORMATS.items()}
+
+# Largest payload a sketch can produce: 255 channels of 4-byte samples
+MAX_PAYLOAD = 255 * 4
+
+
+@dataclass
+class TelemetryFrame:
+    """One decoded frame: a sample for each channel."""
+
+    sample_type: int
+    sequence: int
+    values: Tuple[float, ...]
+
+
+class TelemetryDecoder:
+    """Incrementally decodes telemetry frames from a byte stream."""
+
+    def __init__(self):
+        self._buffer = bytearray()
+        self._formats: Dict[Tuple[int, int], struct.Struct] = {}
+        self._next_sequence = None
+        self.frames_decoded = 0
+        self.frames_lost = 0
+        self.crc_errors = 0
+        self.bytes_skipped = 0
+
+    def feed(self, data) -> List[TelemetryFrame]:
+        """Append received bytes and return every complete frame."""
+        self._buffer += data
+        frames: List[TelemetryFrame] = []
+        buffer = self._buffer
+        position = 0
+
+        with memoryview(buffer) as view:
+            while True:
+                start = buffer.find(SYNC, position)
+                if start < 0:
+                    # Keep a trailing first sync byte, the second may follow
+                    keep = len(buffer) - 1 if buffer.endswith(SYNC[:1]) else len(buffer)
+                    keep = max(keep, position)
+                    self.bytes_skipped += keep - position
+                    position = keep
+                    break
+                self.bytes_skipped += start - position
+                position = start
+
+                if len(buffer) - start < HEADER.size:
+                    break
+                _, length, sample_type, channels, sequence = HEADER.unpack_from(buffer, start)
+                sample_size = SAMPLE_SIZES.get(sample_type)
+                if sample_size is None or length > MAX_PAYLOAD or length != channels * sample_size:
+                    # Not a frame header, resynchronise on the next sync
+                    position = start + 1
+                    self.bytes_skipped += 1
+                    continue
+
+                end = start + HEADER.size + length + CRC.size
+                if len(buffer) < end:
+                    break
+
+                (expected,) = CRC.unpack_from(buffer, end - CRC.size)
+                if binascii.crc_hqx(view[start + 2:end - CRC.size], 0xFFFF) != expected:
+                    self.crc_errors += 1
+                    position = start + 1
+                    self.bytes_skipped += 1
+                    continue
+
+                values = self._format(sample_type, channels).unpack_from(buffer, start + HEADER.size)
+                frames.append(TelemetryFrame(sample_type, sequence, values))
+                self._count_sequence(sequence)
+                position = end
+
+        if position:
+            del buffer[:position]
+        return frames
+
+    def reset(self) -> None:
+        """Drop buffered bytes and forget the sequence position."""
+        self._buffer.clear()
+        self._next_sequence = None
+
+    def _format(self, sample_type: int, channels: int) -> struct.Struct:
+        key = (sample_type, channels)
+        compiled = self._formats.get(key)
+        if compiled is None:
+            compiled = struct.Struct(f"<{channels}{SAMPLE_FORMATS[sample_type]}")
+            self._formats[key] = compiled
+        return compiled
+
+    def _count_sequence(self, sequence: int) -> None:
+        if self._next_sequence is not None:
+            self.frames_lost += (sequence - self._next_sequence) & 0xFF
+        self._next_sequence = (sequence + 1) & 0xFF
+        self.frames_decoded += 1
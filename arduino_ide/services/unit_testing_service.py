@@ -25,6 +25,8 @@ import time
 
 from PySide6.QtCore import QObject, Signal, QProcess, QTimer
 
+from arduino_ide.services.simulated_ports import SimulatedPortScanner
+
 
 class TestFramework(Enum):
     """Supported test frameworks"""
@@ -224,6 +226,8 @@ class UnitTestingService(QObject):
         all_tests_finished: Emitted when all tests complete
         coverage_updated: Emitted when coverage data is updated
         mock_created: Emitted when a mock function is created
+        simulated_port_announced: Emitted when a host test run opens a
+            simulated serial port
     """
 
     # Signals
@@ -234,6 +238,7 @@ class UnitTestingService(QObject):
     all_tests_finished = Signal(int, int, int)  # passed, failed, skipped
     coverage_updated = Signal(TestCoverage)
     mock_created = Signal(MockFunction)
+    simulated_port_announced = Signal(str)  # device path
 
     def __init__(self, project_path: str = "", arduino_cli_path: str = "arduino-cli"):
         super().__init__()
@@ -252,6 +257,7 @@ class UnitTestingService(QObject):
         self.running = False
         self.current_process: Optional[QProcess] = None
         self.test_output_buffer = ""
+        self.port_scanner = SimulatedPortScanner(self.simulated_port_announced.emit)
 
         # Framework-specific parsers
         self.framework_parsers = {
@@ -495,6 +501,7 @@ class UnitTestingService(QObject):
         self.current_process.finished.connect(self._on_test_process_finished)
 
         self.test_output_buffer = ""
+        self.port_scanner.reset()
         self.current_process.start(str(test_executable), [])
 
     def _run_suite_on_host(self, suite: TestSuite):
@@ -515,6 +522,7 @@ class UnitTestingService(QObject):
         args = [f"--gtest_filter={suite.name}.*"]
 
         self.test_output_buffer = ""
+        self.port_scanner.reset()
         self.current_process.start(str(test_executable), args)
 
     def _run_test_on_host(self, test_case: TestCase):
@@ -534,6 +542,7 @@ class UnitTestingService(QObject):
         args = [f"--gtest_filter={test_case.suite_name}.{test_case.name}"]
 
         self.test_output_buffer = ""
+        self.port_scanner.reset()
         self.current_process.start(str(test_executable), args)
 
     def _compile_tests_for_host(self, build_dir: Path) -> bool:
@@ -784,6 +793,7 @@ void loop() {
         if self.current_process:
             error = self.current_process.readAllStandardError().data().decode('utf-8')
             self.test_output_buffer += error
+            self.port_scanner.feed(error)
 
     def _on_test_process_finished(self, exit_code: int, exit_status):
         """Handle test process completion"""
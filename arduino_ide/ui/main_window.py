@@ -306,6 +306,8 @@ class MainWindow(QMainWindow):
 
         self.performance_profiler_service.profiling_started.connect(self._on_profiler_session_started)
         self.performance_profiler_service.profiling_finished.connect(self._on_profiler_session_finished)
+        self.performance_profiler_service.simulated_port_announced.connect(self._offer_simulated_port)
+        self.unit_testing_service.simulated_port_announced.connect(self._offer_simulated_port)
 
         # Unit testing global actions (menus, toolbars, shortcuts)
         self.discover_tests_action = QAction("Discover Tests", self)
@@ -1178,6 +1180,7 @@ class MainWindow(QMainWindow):
 
         # Connect serial monitor data to plotter
         self.serial_monitor.data_received.connect(self.plotter_panel.append_output)
+        self.serial_monitor.bytes_received.connect(self.plotter_panel.add_frames)
         self.serial_monitor.data_received.connect(self._on_serial_monitor_data)
 
         # Add panels to bottom tabs (created in init_ui)
@@ -1913,6 +1916,13 @@ void loop() {
         if not self._is_background_compile:
             self._append_console_stream(text, color="#F48771")
 
+    def _offer_simulated_port(self, device: str):
+        """Let the Serial Monitor attach to a board simulated on the host."""
+
+        if not hasattr(self, "serial_monitor"):
+            return
+        self.serial_monitor.add_simulated_port(device)
+
     def _on_serial_monitor_data(self, payload: str):
         """Forward serial telemetry to the power analyzer service."""
 
@@ -14,6 +14,8 @@ import re
 import csv
 from datetime import datetime
 
+from arduino_ide.services.telemetry_decoder import TelemetryDecoder
+
 
 class PlotWidget(QWidget):
     """Custom widget for plotting data"""
@@ -171,6 +173,9 @@ class PlotterPanel(QWidget):
         super().__init__(parent)
         self.setup_ui()
         self.is_running = False
+        # Switched on by the first valid binary telemetry frame
+        self.binary_mode = False
+        self.telemetry_decoder = TelemetryDecoder()
 
     def setup_ui(self):
         """Setup the UI"""
@@ -236,6 +241,8 @@ class PlotterPanel(QWidget):
     def clear_plot(self):
         """Clear all plot data"""
         self.plot_widget.clear_data()
+        self.binary_mode = False
+        self.telemetry_decoder.reset()
         self.status_label.setText("Plot cleared")
 
     def on_max_points_changed(self, value):
@@ -330,8 +337,31 @@ class PlotterPanel(QWidget):
             # Silently ignore parsing errors
             pass
 
+    def add_frames(self, data):
+        """Decode binary telemetry frames (see Telemetry.h) and plot them"""
+        if not self.is_running:
+            return
+
+        frames = self.telemetry_decoder.feed(data)
+        if not frames:
+            return
+
+        self.binary_mode = True
+        for frame in frames:
+            self.plot_widget.add_data_point(list(frame.values))
+
+        decoder = self.telemetry_decoder
+        self.status_label.setText(
+            f"Frames: {decoder.frames_decoded}, lost: {decoder.frames_lost}, "
+            f"CRC errors: {decoder.crc_errors}"
+        )
+
     def append_output(self, text):
         """Handle serial data input for plotting"""
+        # Text parsing would turn binary frames into bogus points
+        if self.binary_mode:
+            return
+
         # Split by newlines and process each line
         for line in text.split('\n'):
             line = line.strip()
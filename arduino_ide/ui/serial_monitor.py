@@ -2,6 +2,8 @@
 Serial Monitor with multi-device support and plotting capabilities
 """
 
+import os
+
 from PySide6.QtWidgets import (
     QWidget, QVBoxLayout, QHBoxLayout, QTextEdit, QLineEdit,
     QPushButton, QComboBox, QLabel, QTabWidget, QCheckBox
@@ -16,11 +18,13 @@ class SerialMonitor(QWidget):
     """Multi-device serial monitor with plotting"""
 
     data_received = Signal(str)
+    bytes_received = Signal(bytes)
 
     def __init__(self, parent=None):
         super().__init__(parent)
 
         self.serial_connections = {}
+        self.simulated_ports = {}
         self.init_ui()
 
     def init_ui(self):
@@ -102,9 +106,24 @@ class SerialMonitor(QWidget):
         for port in ports:
             self.port_combo.addItem(f"{port.device} - {port.description}", port.device)
 
+        # Simulated boards disappear with their process
+        for device in list(self.simulated_ports):
+            if not os.path.exists(device):
+                del self.simulated_ports[device]
+                continue
+            self.port_combo.addItem(f"{device} - {self.simulated_ports[device]}", device)
+
         if self.port_combo.count() == 0:
             self.port_combo.addItem("No ports found", None)
 
+    def add_simulated_port(self, device, description="Simulated board"):
+        """Offer the pseudo-terminal of a host-simulated sketch as a port"""
+        self.simulated_ports[device] = description
+        self.refresh_ports()
+        index = self.port_combo.findData(device)
+        if index >= 0:
+            self.port_combo.setCurrentIndex(index)
+
     def toggle_connection(self):
         """Connect or disconnect from serial port"""
         port_data = self.port_combo.currentData()
@@ -151,7 +170,9 @@ class SerialMonitor(QWidget):
         for port, ser in self.serial_connections.items():
             try:
                 if ser.in_waiting > 0:
-                    data = ser.read(ser.in_waiting).decode('utf-8', errors='replace')
+                    raw = ser.read(ser.in_waiting)
+                    self.bytes_received.emit(raw)
+                    data = raw.decode('utf-8', errors='replace')
                     self.append_output(data)
                     self.data_received.emit(data)
 
@@ -0,0 +1,129 @@
+/*
+  adc_replay.cpp - Capture replay through analogRead()
+
+  Runs in a fresh instance so virtual time starts at 0. Captures are
+  written to the working directory.
+*/
+
+#include "check.h"
+
+static SimContext instance;
+
+// analogRead(pin) once the clock reaches time_us
+static int readAt(uint8_t pin, uint64_t time_us) {
+    schedulerSleepUntil(time_us);
+    return analogRead(pin);
+}
+
+static void writeRaw(const char *path, const int16_t *samples, size_t count) {
+    FILE *file = fopen(path, "wb");
+    fwrite(samples, sizeof(samples[0]), count, file);
+    fclose(file);
+}
+
+static void testReplay(void) {
+    static const int16_t samples[] = { 100, 200, 300, 400 };
+    writeRaw("capture.raw", samples, 4);
+
+    // 1 kHz: one sample per millisecond from the time of attaching
+    uint64_t base = clockMicros64();
+    CHECK(adcAttachFile(A0, "capture.raw", 1000));
+    CHECK_EQ(readAt(A0, base), 100);
+    CHECK_EQ(readAt(A0, base + 999), 100);
+    CHECK_EQ(readAt(A0, base + 1000), 200);
+    CHECK_EQ(readAt(A0, base + 3500), 400);
+    // Past the end the last sample holds
+    CHECK_EQ(readAt(A0, base + 10000), 400);
+
+    base = clockMicros64();
+    CHECK(adcAttachFile(A0, "capture.raw", 1000, true));
+    CHECK_EQ(readAt(A0, base + 4000), 100);
+    CHECK_EQ(readAt(A0, base + 6000), 300);
+
+    // A term adds to the stream; detaching leaves the term
+    CHECK(adcAddConstant(A0, 10));
+    CHECK_EQ(readAt(A0, base + 7000), 410);
+    adcDetach(A0);
+    CHECK_EQ(analogRead(A0), 10);
+    adcClearSignals(A0);
+    CHECK_EQ(analogRead(A0), 0);
+
+    CHECK(!adcAttachFile(A1, "missing.raw", 1000));
+    CHECK_EQ(analogRead(A1), 0);
+    CHECK_EQ(analogRead(NUM_ANALOG_INPUTS + 20), 0);
+}
+
+// Sample i of a capture holding 0, 1, 2, ... must apply from exactly
+// i * 10^6 / rate microseconds after attaching
+static unsigned rateMismatches(uint32_t rate_hz, uint64_t step_us, uint64_t span_us) {
+    uint64_t base = clockMicros64();
+    adcAttachFile(A2, "ramp.raw", rate_hz);
+    unsigned mismatches = 0;
+    for (uint64_t t = 0; t < span_us; t += step_us) {
+        if (readAt(A2, base + t) != (int)(t * rate_hz / 1000000)) {
+            mismatches++;
+        }
+    }
+    adcDetach(A2);
+    return mismatches;
+}
+
+static void testRates(void) {
+    int16_t ramp[1000];
+    for (int i = 0; i < 1000; i++) {
+        ramp[i] = (int16_t)i;
+    }
+    writeRaw("ramp.raw", ramp, 1000);
+    CHECK_EQ(rateMismatches(44100, 1, 1000 * 1000000ULL / 44100), 0);
+    CHECK_EQ(rateMismatches(48000, 1, 1000 * 1000000ULL / 48000), 0);
+    CHECK_EQ(rateMismatches(999999, 1, 1000), 0);
+    CHECK_EQ(rateMismatches(7, 1, 3 * 1000000ULL), 0);
+    CHECK_EQ(rateMismatches(3, 333333, 300 * 1000000ULL), 0);
+}
+
+static void testCsv(void) {
+    // A header, a row much longer than any line buffer, and a bad row
+    FILE *file = fopen("capture.csv", "w");
+    fprintf(file, "time,value\n");
+    fprintf(file, "0,11\n1,22\n");
+    fprintf(file, "2,33");
+    for (int i = 0; i < 2000; i++) {
+        fprintf(file, ",%d", i);
+    }
+    fprintf(file, "\nbad,row\n3,44\n");
+    fclose(file);
+
+    uint64_t base = clockMicros64();
+    CHECK(adcAttachFile(A1, "capture.csv", 100, false, 1));
+    CHECK_EQ(readAt(A1, base), 11);
+    CHECK_EQ(readAt(A1, base + 10000), 22);
+    CHECK_EQ(readAt(A1, base + 20000), 33);
+    CHECK_EQ(readAt(A1, base + 30000), 44);
+    adcDetach(A1);
+
+    // The spec of $ARDUINO_ADC_An, with '@' and ',' in the file name
+    static const int16_t samples[] = { 5, 6, 7 };
+    writeRaw("run@2,x.raw", samples, 3);
+    setenv("ARDUINO_ADC_A2", "run@2,x.raw@100,loop", 1);
+    base = clockMicros64();
+    adcInit();
+    unsetenv("ARDUINO_ADC_A2");
+    CHECK_EQ(readAt(A2, base), 5);
+    CHECK_EQ(readAt(A2, base + 20000), 7);
+    CHECK_EQ(readAt(A2, base + 30000), 5);
+    adcDetach(A2);
+}
+
+void setup() {
+    simContextInit(&instance, 1);
+    SimContext *previous = simSetContext(&instance);
+    testReplay();
+    testRates();
+    testCsv();
+    simSetContext(previous);
+    simContextFree(&instance);
+    checkDone();
+}
+
+void loop() {
+}
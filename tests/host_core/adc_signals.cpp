@@ -0,0 +1,134 @@
+/*
+  adc_signals.cpp - Generated signals of the simulated ADC
+
+  Runs in a fresh instance so virtual time starts at 0.
+*/
+
+#include "check.h"
+
+static SimContext instance;
+
+// analogRead(pin) once the clock reaches time_us
+static int readAt(uint8_t pin, uint64_t time_us) {
+    schedulerSleepUntil(time_us);
+    return analogRead(pin);
+}
+
+static void testPeriodic(void) {
+    // 10 Hz sine of amplitude 100 around 512
+    uint64_t base = clockMicros64();
+    CHECK(adcAddConstant(A3, 512));
+    CHECK(adcAddSine(A3, 100, 10));
+    CHECK_EQ(readAt(A3, base), 512);
+    CHECK_EQ(readAt(A3, base + 25000), 612);
+    CHECK_EQ(readAt(A3, base + 50000), 512);
+    CHECK_EQ(readAt(A3, base + 75000), 412);
+    CHECK_EQ(readAt(A3, base + 125000), 612);
+    adcClearSignals(A3);
+
+    // Square, high for the first quarter of each period
+    base = clockMicros64();
+    CHECK(adcAddConstant(A3, 500));
+    CHECK(adcAddSquare(A3, 50, 10, 0.25));
+    CHECK_EQ(readAt(A3, base), 550);
+    CHECK_EQ(readAt(A3, base + 24999), 550);
+    CHECK_EQ(readAt(A3, base + 25000), 450);
+    CHECK_EQ(readAt(A3, base + 100000), 550);
+    adcClearSignals(A3);
+
+    // Ramp from -amplitude to +amplitude over each period
+    base = clockMicros64();
+    CHECK(adcAddConstant(A3, 500));
+    CHECK(adcAddRamp(A3, 100, 10));
+    CHECK_EQ(readAt(A3, base), 400);
+    CHECK_EQ(readAt(A3, base + 50000), 500);
+    CHECK_EQ(readAt(A3, base + 75000), 550);
+    CHECK_EQ(readAt(A3, base + 100000), 400);
+
+    // At most ADC_MAX_SIGNALS terms
+    CHECK(adcAddConstant(A3, 0));
+    CHECK(adcAddConstant(A3, 0));
+    CHECK(!adcAddConstant(A3, 0));
+    adcClearSignals(A3);
+
+    // The sum is clamped
+    CHECK(adcAddConstant(A3, 2000));
+    CHECK_EQ(analogRead(A3), ADC_MAX);
+    adcClearSignals(A3);
+    CHECK(adcAddConstant(A3, -5));
+    CHECK_EQ(analogRead(A3), 0);
+    adcClearSignals(A3);
+}
+
+static void testNoise(void) {
+    // New value every millisecond; the same one for every read within it
+    uint64_t base = clockMicros64();
+    CHECK(adcAddConstant(A4, 500));
+    CHECK(adcAddNoise(A4, 10, 1000, 7));
+    int first = readAt(A4, base + 100);
+    CHECK_EQ(analogRead(A4), first);
+    CHECK_EQ(readAt(A4, base + 999), first);
+
+    double sum = 0, squares = 0;
+    const int n = 20000;
+    for (int i = 0; i < n; i++) {
+        double value = readAt(A4, base + 1000 + i * 1000ULL) - 500.0;
+        sum += value;
+        squares += value * value;
+    }
+    double mean = sum / n;
+    double sigma = sqrt(squares / n - mean * mean);
+    CHECK(mean > -0.5 && mean < 0.5);
+    CHECK(sigma > 9.5 && sigma < 10.5);
+
+    // The same seed replays the same values
+    int replay[5], again[5];
+    adcClearSignals(A4);
+    base = clockMicros64();
+    adcAddNoise(A4, 10, 1000, 3);
+    adcAddConstant(A4, 500);
+    for (int i = 0; i < 5; i++) {
+        replay[i] = readAt(A4, base + i * 1000ULL);
+    }
+    adcClearSignals(A4);
+    base = clockMicros64();
+    adcAddNoise(A4, 10, 1000, 3);
+    adcAddConstant(A4, 500);
+    for (int i = 0; i < 5; i++) {
+        again[i] = readAt(A4, base + i * 1000ULL);
+    }
+    CHECK(memcmp(replay, again, sizeof(replay)) == 0);
+    adcClearSignals(A4);
+}
+
+static void testPiecewise(void) {
+    static const SimAdcPoint points[] = { { 0, 0 }, { 1000, 1000 }, { 2000, 200 } };
+    uint64_t base = clockMicros64();
+    CHECK(adcAddPiecewise(A5, points, 3));
+    CHECK_EQ(readAt(A5, base + 500), 500);
+    CHECK_EQ(readAt(A5, base + 1500), 600);
+    CHECK_EQ(readAt(A5, base + 5000), 200);
+    adcClearSignals(A5);
+
+    // Looping repeats the shape every 2000 us
+    base = clockMicros64();
+    CHECK(adcAddPiecewise(A5, points, 3, true));
+    CHECK_EQ(readAt(A5, base + 2500), 500);
+    CHECK_EQ(readAt(A5, base + 3750), 400);
+    CHECK_EQ(readAt(A5, base + 4250), 250);
+    adcClearSignals(A5);
+}
+
+void setup() {
+    simContextInit(&instance, 1);
+    SimContext *previous = simSetContext(&instance);
+    testPeriodic();
+    testNoise();
+    testPiecewise();
+    simSetContext(previous);
+    simContextFree(&instance);
+    checkDone();
+}
+
+void loop() {
+}
@@ -0,0 +1,102 @@
+/*
+  allocators.cpp - Pool and arena exhaustion of the String allocators
+*/
+
+#include "check.h"
+
+static const char text40[] = "0123456789012345678901234567890123456789";
+
+static void testPool(void) {
+    StringPool<32, 2> pool;
+    stringSetAllocator(&pool);
+    {
+        String a(text40 + 20);
+        String b(text40 + 20);
+        CHECK(a.allocator() == &pool);
+        CHECK(b.allocator() == &pool);
+        CHECK_EQ(pool.allocations(), 2);
+        // The pool is empty: the next String moves to the heap
+        String c(text40 + 20);
+        CHECK(c.allocator() == &stringHeap);
+        CHECK_EQ(pool.overflows(), 1);
+        CHECK_STR(c.c_str(), text40 + 20);
+        // So does one outgrowing its block, freeing the block
+        a += text40;
+        CHECK(a.allocator() == &stringHeap);
+        CHECK_EQ(a.length(), 60);
+        CHECK_EQ(pool.overflows(), 2);
+        String d(text40 + 30);
+        CHECK(d.allocator() == &pool);
+    }
+    CHECK_EQ(pool.used(), 0);
+    CHECK_EQ(pool.peak(), 64);
+    stringSetAllocator(NULL);
+}
+
+static void testArena(void) {
+    StringArena<64> arena;
+    stringSetAllocator(&arena);
+    {
+        String a(text40);
+        CHECK(a.allocator() == &arena);
+        CHECK_EQ(arena.used(), 41);
+        // 23 bytes left: not enough for another 40 characters
+        String b(text40);
+        CHECK(b.allocator() == &stringHeap);
+        CHECK_EQ(arena.overflows(), 1);
+        String c(text40 + 20);
+        CHECK(c.allocator() == &arena);
+        CHECK_EQ(arena.used(), 62);
+    }
+    arena.reset();
+    CHECK_EQ(arena.used(), 0);
+    CHECK_EQ(arena.peak(), 62);
+    stringSetAllocator(NULL);
+}
+
+// A loop arena serves Strings made inside loop() and empties after it
+static StringArena<256> loopArena;
+static SimContext instance;
+static bool loopUsedArena;
+static size_t usedInLoop;
+
+static void arenaSetup(void) {
+    stringSetLoopArena(&loopArena);
+}
+
+static void arenaLoop(void) {
+    String line(text40);
+    line += text40;
+    loopUsedArena = line.allocator() == &loopArena;
+    usedInLoop = loopArena.used();
+}
+
+static void testLoopArena(void) {
+    simContextInit(&instance, 1);
+    instance.setup = arenaSetup;
+    instance.loop = arenaLoop;
+    SimContext *previous = simSetContext(&instance);
+    schedulerSetLoopLimit(3);
+    simContextBegin();
+    while (schedulerStep(SIZE_MAX)) {
+    }
+    CHECK(loopUsedArena);
+    CHECK(usedInLoop >= 81);
+    CHECK_EQ(loopArena.used(), 0);
+    CHECK_EQ(loopArena.overflows(), 0);
+    // Outside loop() the context's default applies again
+    String outside(text40);
+    CHECK(outside.allocator() == &stringHeap);
+    simSetContext(previous);
+    simContextFree(&instance);
+}
+
+void setup() {
+    testPool();
+    testArena();
+    testLoopArena();
+    checkDone();
+}
+
+void loop() {
+}
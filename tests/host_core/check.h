@@ -0,0 +1,56 @@
+/*
+  check.h - Assertions for the host-built core drivers
+
+  Each driver is a sketch whose setup() runs its checks and ends with
+  checkDone(). A failed check prints "FAIL file:line: expression" with
+  the values compared; checkDone() exits with status 1 if any failed, so
+  tests/test_host_core.py only has to look at the exit status.
+*/
+
+#ifndef check_h
+#define check_h
+
+// Standard library headers must come before Arduino.h and its macros
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <utility>
+
+#include "Arduino.h"
+
+static unsigned checkFailures = 0;
+static unsigned checkCount = 0;
+
+inline bool checkResult(bool ok, const char *expr, const char *file, int line) {
+    checkCount++;
+    if (!ok) {
+        checkFailures++;
+        printf("FAIL %s:%d: %s\n", file, line, expr);
+    }
+    return ok;
+}
+
+inline void checkEqual(long long actual, long long expected, const char *expr, const char *file, int line) {
+    if (!checkResult(actual == expected, expr, file, line)) {
+        printf("  got %lld, expected %lld\n", actual, expected);
+    }
+}
+
+inline void checkString(const char *actual, const char *expected, const char *expr, const char *file, int line) {
+    if (!checkResult(strcmp(actual, expected) == 0, expr, file, line)) {
+        printf("  got \"%s\", expected \"%s\"\n", actual, expected);
+    }
+}
+
+#define CHECK(cond) checkResult((cond), #cond, __FILE__, __LINE__)
+#define CHECK_EQ(actual, expected) \
+    checkEqual((long long)(actual), (long long)(expected), #actual " == " #expected, __FILE__, __LINE__)
+#define CHECK_STR(actual, expected) \
+    checkString((actual), (expected), #actual " == " #expected, __FILE__, __LINE__)
+
+inline void checkDone(void) {
+    printf("%u checks, %u failed\n", checkCount, checkFailures);
+    exit(checkFailures == 0 ? 0 : 1);
+}
+
+#endif
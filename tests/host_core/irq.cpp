@@ -0,0 +1,214 @@
+/*
+  irq.cpp - Edge modes, lost triggers and masking of attachInterrupt()
+
+  Runs in a fresh instance. Stimuli come from pinDrive(), from the
+  sketch's own writes and from a PWM output.
+*/
+
+#include "check.h"
+
+static SimContext instance;
+static uint32_t calls;
+static uint64_t callTimes[8];
+
+static void onEdge(void) {
+    if (calls < 8) {
+        callTimes[calls] = clockMicros64();
+    }
+    calls++;
+}
+
+// Drives pin 2 through levels, giving the controller a service point
+// after each
+static void drive(const uint8_t *levels, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        pinDrive(2, levels[i]);
+        delayMicroseconds(1);
+    }
+}
+
+static const uint8_t pulses[] = { HIGH, LOW, HIGH, LOW, HIGH, LOW };
+
+static void testPinMap(void) {
+    CHECK_EQ(digitalPinToInterrupt(2), 0);
+    CHECK_EQ(digitalPinToInterrupt(3), 1);
+    CHECK_EQ(digitalPinToInterrupt(4), NOT_AN_INTERRUPT);
+    CHECK_EQ(irqStats().serviced, 0);
+}
+
+static void testModes(void) {
+    pinMode(2, INPUT);
+    pinDrive(2, LOW);
+
+    calls = 0;
+    attachInterrupt(digitalPinToInterrupt(2), onEdge, RISING);
+    drive(pulses, 6);
+    CHECK_EQ(calls, 3);
+
+    calls = 0;
+    attachInterrupt(0, onEdge, FALLING);
+    drive(pulses, 6);
+    CHECK_EQ(calls, 3);
+
+    calls = 0;
+    attachInterrupt(0, onEdge, CHANGE);
+    drive(pulses, 6);
+    CHECK_EQ(calls, 6);
+    // Driving the level the pin already has is no edge
+    pinDrive(2, LOW);
+    delayMicroseconds(1);
+    CHECK_EQ(calls, 6);
+
+    // Detached interrupts see nothing, and their queued triggers are dropped
+    noInterrupts();
+    pinDrive(2, HIGH);
+    detachInterrupt(0);
+    interrupts();
+    pinDrive(2, LOW);
+    delayMicroseconds(1);
+    CHECK_EQ(calls, 6);
+    // Out-of-range numbers are ignored
+    attachInterrupt(NOT_AN_INTERRUPT, onEdge, CHANGE);
+    attachInterrupt(2, onEdge, CHANGE);
+    detachInterrupt(7);
+}
+
+static void stimulus(void *arg) {
+    pinDrive(2, (uint8_t)(uintptr_t)arg);
+}
+
+static void testEventTiming(void) {
+    // A stimulus posted as an event is serviced at its own instant
+    calls = 0;
+    irqResetStats();
+    attachInterrupt(0, onEdge, RISING);
+    uint64_t base = clockMicros64();
+    schedulerPost(base + 100, SIM_EVENT_TIMER, stimulus, (void *)HIGH);
+    schedulerPost(base + 150, SIM_EVENT_TIMER, stimulus, (void *)LOW);
+    schedulerPost(base + 250, SIM_EVENT_TIMER, stimulus, (void *)HIGH);
+    schedulerPost(base + 300, SIM_EVENT_TIMER, stimulus, (void *)LOW);
+    delay(1);
+    CHECK_EQ(calls, 2);
+    CHECK_EQ(callTimes[0], base + 100);
+    CHECK_EQ(callTimes[1], base + 250);
+    SimIrqStats stats = irqStats();
+    CHECK_EQ(stats.serviced, 2);
+    CHECK_EQ(stats.lost, 0);
+    CHECK_EQ(stats.delay_us_max, 0);
+    CHECK(stats.latency_ns_max >= stats.latency_ns_total / 2);
+}
+
+static void testMasking(void) {
+    // Own writes on an output pin raise the interrupt too
+    detachInterrupt(0);
+    pinRelease(2);
+    pinMode(2, OUTPUT);
+    digitalWrite(2, LOW);
+    attachInterrupt(0, onEdge, CHANGE);
+    irqResetStats();
+
+    // noInterrupts() holds triggers across delay(); interrupts() runs them
+    calls = 0;
+    noInterrupts();
+    for (int i = 0; i < 10; i++) {
+        digitalWrite(2, i % 2 == 0 ? HIGH : LOW);
+    }
+    delay(5);
+    CHECK_EQ(calls, 0);
+    interrupts();
+    CHECK_EQ(calls, 10);
+
+    // Beyond IRQ_QUEUE_CAPACITY pending triggers the rest are lost
+    calls = 0;
+    noInterrupts();
+    for (int i = 0; i < IRQ_QUEUE_CAPACITY + 36; i++) {
+        digitalWrite(2, i % 2 == 0 ? HIGH : LOW);
+    }
+    interrupts();
+    CHECK_EQ(calls, IRQ_QUEUE_CAPACITY);
+    CHECK_EQ(irqStats().lost, 36);
+    CHECK_EQ(irqStats().serviced, 10 + IRQ_QUEUE_CAPACITY);
+    irqResetStats();
+    CHECK_EQ(irqStats().lost, 0);
+}
+
+// Toggles its own pin: the trigger that raises waits until it returns
+static uint32_t depth, maxDepth, selfCalls;
+
+static void onSelf(void) {
+    depth++;
+    if (depth > maxDepth) {
+        maxDepth = depth;
+    }
+    if (++selfCalls < 5) {
+        digitalWrite(2, digitalRead(2) == HIGH ? LOW : HIGH);
+    }
+    depth--;
+}
+
+static void testNesting(void) {
+    maxDepth = 0;
+    selfCalls = 0;
+    attachInterrupt(0, onSelf, CHANGE);
+    digitalWrite(2, HIGH);
+    delayMicroseconds(1);
+    CHECK_EQ(selfCalls, 5);
+    CHECK_EQ(maxDepth, 1);
+    detachInterrupt(0);
+}
+
+static void onLow(void) {
+    calls++;
+    if (calls == 3) {
+        pinDrive(2, HIGH);
+    }
+}
+
+static void testLevel(void) {
+    // LOW runs at every service point while the pin is low
+    pinMode(2, INPUT);
+    pinDrive(2, LOW);
+    calls = 0;
+    attachInterrupt(0, onLow, LOW);
+    for (int i = 0; i < 10; i++) {
+        delayMicroseconds(1);
+    }
+    CHECK_EQ(calls, 3);
+    detachInterrupt(0);
+    pinRelease(2);
+}
+
+static uint32_t rises;
+
+static void onRise(void) {
+    rises++;
+}
+
+static void testPwmSource(void) {
+    // Timer2 on pin 3 (INT1): one rising edge per 2040 us period
+    analogWrite(3, 100);
+    attachInterrupt(digitalPinToInterrupt(3), onRise, RISING);
+    rises = 0;
+    delay(1000);
+    CHECK(rises == 490 || rises == 491);
+    detachInterrupt(1);
+    analogWrite(3, 0);
+}
+
+void setup() {
+    simContextInit(&instance, 1);
+    SimContext *previous = simSetContext(&instance);
+    testPinMap();
+    testModes();
+    testEventTiming();
+    testMasking();
+    testNesting();
+    testLevel();
+    testPwmSource();
+    simSetContext(previous);
+    simContextFree(&instance);
+    checkDone();
+}
+
+void loop() {
+}
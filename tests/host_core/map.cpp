@@ -0,0 +1,110 @@
+/*
+  map.cpp - map<>(), mapWide() and mapSamples() against the reference map()
+*/
+
+#include "check.h"
+
+// map()'s formula without overflow
+static long referenceMap(long x, long in_min, long in_max, long out_min, long out_max) {
+    __int128 scaled = ((__int128)x - in_min) * ((__int128)out_max - out_min) / ((__int128)in_max - in_min);
+    return (long)(scaled + out_min);
+}
+
+// Sweeps x over the input range and a margin on each side; returns the
+// number of values where map<>() and map() disagree
+template <long InMin, long InMax, long OutMin, long OutMax>
+static unsigned sweep(long margin) {
+    long low = InMin < InMax ? InMin : InMax;
+    long high = InMin < InMax ? InMax : InMin;
+    unsigned mismatches = 0;
+    for (long x = low - margin; x <= high + margin; x++) {
+        long expected = map(x, InMin, InMax, OutMin, OutMax);
+        if (map<InMin, InMax, OutMin, OutMax>(x) != expected || mapWide(x, InMin, InMax, OutMin, OutMax) != expected) {
+            if (mismatches++ < 3) {
+                printf("  map<%ld, %ld, %ld, %ld>(%ld): %ld, expected %ld\n", InMin, InMax, OutMin, OutMax, x,
+                       map<InMin, InMax, OutMin, OutMax>(x), expected);
+            }
+        }
+    }
+    return mismatches;
+}
+
+static void testTemplate(void) {
+    CHECK_EQ((sweep<0, 1023, 0, 255>(100)), 0);
+    CHECK_EQ((sweep<0, 1023, 255, 0>(100)), 0);
+    CHECK_EQ((sweep<0, 1023, -1000, 1000>(100)), 0);
+    CHECK_EQ((sweep<1023, 0, 0, 100>(100)), 0);
+    CHECK_EQ((sweep<-100, 100, 1000, -1000>(50)), 0);
+    CHECK_EQ((sweep<0, 4095, 0, 3300>(10)), 0);
+    CHECK_EQ((sweep<-32768, 32767, 0, 65535>(10)), 0);
+    CHECK_EQ((sweep<0, 7, 0, 1000000>(10)), 0);
+    CHECK_EQ((sweep<0, 100000, 0, 3>(10)), 0);
+
+    // Usable in constant expressions
+    static_assert(map<0, 1023, 0, 255>(1023) == 255, "map<> at the top of the range");
+    static_assert(map<0, 1023, 0, 255>(512) == 127, "map<> mid-range");
+}
+
+static void testWide(void) {
+    // Ranges whose product overflows map() on a 32-bit long
+    CHECK_EQ(mapWide(1000000, 0, 2000000, 0, 2000000), 1000000);
+    CHECK_EQ(mapWide(-70000, -100000, 100000, -100000, 100000), -70000);
+    CHECK_EQ(mapWide(LONG_MAX, 0, LONG_MAX, 0, 1000), 1000);
+    CHECK_EQ(mapWide(LONG_MIN, LONG_MIN, LONG_MAX, -1, 1), -1);
+    CHECK_EQ(mapWide(LONG_MAX, LONG_MIN, LONG_MAX, LONG_MIN, LONG_MAX), LONG_MAX);
+    // An empty input range maps to out_min
+    CHECK_EQ(mapWide(5, 3, 3, 7, 9), 7);
+
+    // Truncates toward zero like map(), on random operands
+    randomSeed(20);
+    unsigned mismatches = 0;
+    for (int i = 0; i < 10000; i++) {
+        long in_min = random(-1000000000L, 1000000000L);
+        long in_max = random(-1000000000L, 1000000000L);
+        long out_min = random(-1000000000L, 1000000000L);
+        long out_max = random(-1000000000L, 1000000000L);
+        long x = random(-1000000000L, 1000000000L);
+        if (in_min != in_max && mapWide(x, in_min, in_max, out_min, out_max) != referenceMap(x, in_min, in_max, out_min, out_max)) {
+            mismatches++;
+        }
+    }
+    CHECK_EQ(mismatches, 0);
+}
+
+// mapSamples() over every int16 value, against saturated mapWide()
+static unsigned sampleMismatches(long in_min, long in_max, long out_min, long out_max) {
+    static int16_t in[65536], out[65536];
+    for (long i = 0; i < 65536; i++) {
+        in[i] = (int16_t)(i - 32768);
+    }
+    mapSamples(in, out, 65536, in_min, in_max, out_min, out_max);
+    unsigned mismatches = 0;
+    for (long i = 0; i < 65536; i++) {
+        long expected = mapWide(in[i], in_min, in_max, out_min, out_max);
+        expected = expected < INT16_MIN ? INT16_MIN : expected > INT16_MAX ? INT16_MAX : expected;
+        mismatches += out[i] != expected;
+    }
+    // In place, over an odd count so the scalar tail runs too
+    mapSamples(in, in, 65535, in_min, in_max, out_min, out_max);
+    mismatches += memcmp(in, out, 65535 * sizeof(int16_t)) != 0;
+    return mismatches;
+}
+
+static void testSamples(void) {
+    CHECK_EQ(sampleMismatches(0, 1023, 0, 255), 0);
+    CHECK_EQ(sampleMismatches(0, 1023, 0, 5000), 0);
+    CHECK_EQ(sampleMismatches(-512, 511, 1000, -1000), 0);
+    CHECK_EQ(sampleMismatches(0, 3, 0, 1000000), 0);
+    CHECK_EQ(sampleMismatches(100, 100, -7, 7), 0);
+    CHECK_EQ(sampleMismatches(0, 1, LONG_MIN / 2, LONG_MAX / 2), 0);
+}
+
+void setup() {
+    testTemplate();
+    testWide();
+    testSamples();
+    checkDone();
+}
+
+void loop() {
+}
@@ -0,0 +1,130 @@
+/*
+  pins.cpp - Port register semantics of the pin layer
+*/
+
+#include "check.h"
+
+static void testPinMap(void) {
+    CHECK_EQ(digitalPinToPort(0), PD);
+    CHECK_EQ(digitalPinToBitMask(7), 0x80);
+    CHECK_EQ(digitalPinToPort(8), PB);
+    CHECK_EQ(digitalPinToBitMask(13), 0x20);
+    CHECK_EQ(digitalPinToPort(A0), PC);
+    CHECK_EQ(digitalPinToBitMask(A5), 0x20);
+    // Pins past the board map to an empty mask
+    CHECK_EQ(digitalPinToBitMask(NUM_DIGITAL_PINS), 0);
+    CHECK_EQ(digitalPinToBitMask(200), 0);
+}
+
+static void testModes(void) {
+    SimPins &pins = simContext()->pins;
+
+    // Floating inputs read LOW, pulled-up ones HIGH
+    pinMode(4, INPUT);
+    CHECK_EQ(digitalRead(4), LOW);
+    pinMode(4, INPUT_PULLUP);
+    CHECK_EQ(digitalRead(4), HIGH);
+    CHECK(pins.port[PD] & 0x10);
+    CHECK(!(pins.ddr[PD] & 0x10));
+
+    // An external driver wins over the pull-up until released
+    pinDrive(4, LOW);
+    CHECK_EQ(digitalRead(4), LOW);
+    pinRelease(4);
+    CHECK_EQ(digitalRead(4), HIGH);
+
+    // digitalWrite() on an input sets the pull-up, as on the chip
+    pinMode(4, INPUT);
+    digitalWrite(4, HIGH);
+    CHECK_EQ(digitalRead(4), HIGH);
+    digitalWrite(4, LOW);
+    CHECK_EQ(digitalRead(4), LOW);
+
+    // Outputs read back their latch, whatever drives them from outside
+    pinMode(13, OUTPUT);
+    digitalWrite(13, HIGH);
+    CHECK_EQ(digitalRead(13), HIGH);
+    CHECK(pins.ddr[PB] & 0x20);
+    CHECK(pins.pin[PB] & 0x20);
+    pinDrive(13, LOW);
+    CHECK_EQ(digitalRead(13), HIGH);
+    digitalWrite(13, LOW);
+    CHECK_EQ(digitalRead(13), LOW);
+    // Back to input, the external level shows
+    pinDrive(13, HIGH);
+    pinMode(13, INPUT);
+    CHECK_EQ(digitalRead(13), HIGH);
+    pinRelease(13);
+    CHECK_EQ(digitalRead(13), LOW);
+
+    // Any non-zero value is HIGH
+    pinMode(12, OUTPUT);
+    digitalWrite(12, 7);
+    CHECK_EQ(digitalRead(12), HIGH);
+    digitalWrite(12, LOW);
+
+    // Invalid pins are ignored
+    uint8_t before = pins.port[PB];
+    pinMode(200, OUTPUT);
+    digitalWrite(200, HIGH);
+    CHECK_EQ(digitalRead(200), LOW);
+    CHECK_EQ(pins.port[PB], before);
+}
+
+static void testFast(void) {
+    pinModeFast<11>(OUTPUT);
+    digitalWriteFast<11>(HIGH);
+    CHECK_EQ(digitalRead(11), HIGH);
+    CHECK_EQ(digitalReadFast<11>(), HIGH);
+    digitalWriteFast(11, LOW);
+    CHECK_EQ(digitalReadFast(11), LOW);
+    CHECK_EQ(digitalRead(11), LOW);
+}
+
+static void testPorts(void) {
+    for (uint8_t pin = 8; pin < 12; pin++) {
+        pinMode(pin, OUTPUT);
+    }
+    // Only the mask bits change
+    digitalWritePort(PB, 0x0F, 0xF5);
+    CHECK_EQ(digitalRead(8), HIGH);
+    CHECK_EQ(digitalRead(9), LOW);
+    CHECK_EQ(digitalRead(10), HIGH);
+    CHECK_EQ(digitalRead(11), LOW);
+    CHECK_EQ(digitalReadPort(PB) & 0x0F, 0x05);
+    digitalWritePort(PB, 0x02, 0xFF);
+    CHECK_EQ(digitalReadPort(PB) & 0x0F, 0x07);
+    CHECK_EQ(digitalReadPort(NUM_PORTS), 0);
+
+    // A group spans ports; bit i of the value is pins[i]
+    static const uint8_t groupPins[] = { 2, 9, A1, 10 };
+    PinGroup group;
+    pinGroupInit(&group, groupPins, 4);
+    for (uint8_t i = 0; i < 4; i++) {
+        pinMode(groupPins[i], OUTPUT);
+    }
+    pinGroupWrite(&group, 0x5);
+    CHECK_EQ(digitalRead(2), HIGH);
+    CHECK_EQ(digitalRead(9), LOW);
+    CHECK_EQ(digitalRead(A1), HIGH);
+    CHECK_EQ(digitalRead(10), LOW);
+    // Pins outside the group keep their level
+    CHECK_EQ(digitalRead(8), HIGH);
+    pinGroupWrite(&group, 0xA);
+    CHECK_EQ(digitalRead(2), LOW);
+    CHECK_EQ(digitalRead(9), HIGH);
+    CHECK_EQ(digitalRead(A1), LOW);
+    CHECK_EQ(digitalRead(10), HIGH);
+    CHECK_EQ(digitalRead(8), HIGH);
+}
+
+void setup() {
+    testPinMap();
+    testModes();
+    testFast();
+    testPorts();
+    checkDone();
+}
+
+void loop() {
+}
@@ -0,0 +1,154 @@
+/*
+  pwm.cpp - Waveform, level and next-edge timing of analogWrite() outputs
+
+  Runs in a fresh instance so the timers' time 0 is the start of the run.
+*/
+
+#include "check.h"
+
+static SimContext instance;
+
+// digitalRead(pin) once the clock reaches time_us
+static int readAt(uint8_t pin, uint64_t time_us) {
+    schedulerSleepUntil(time_us);
+    return digitalRead(pin);
+}
+
+static void testPhaseCorrect(void) {
+    // Timer1, 2040 us period, high for 2 * 64 ticks centred on the period
+    // boundary
+    analogWrite(9, 64);
+    CHECK(pwmRunning(9));
+    CHECK_EQ(pwmValue(9), 64);
+    CHECK_EQ(pwmPeriodMicros(9), 2040);
+    CHECK_EQ(pwmHighMicros(9), 512);
+    CHECK(fabs(pwmFrequency(9) - 490.196f) < 0.01f);
+    CHECK(fabs(pwmAverage(9) - 512.0f / 2040) < 1e-6f);
+
+    CHECK_EQ(pwmLevelAt(9, 0), HIGH);
+    CHECK_EQ(pwmLevelAt(9, 255), HIGH);
+    CHECK_EQ(pwmLevelAt(9, 256), LOW);
+    CHECK_EQ(pwmLevelAt(9, 1783), LOW);
+    CHECK_EQ(pwmLevelAt(9, 1784), HIGH);
+    CHECK_EQ(pwmLevelAt(9, 2040 * 1000 + 100), HIGH);
+    CHECK_EQ(pwmNextEdge(9, 0), 256);
+    CHECK_EQ(pwmNextEdge(9, 256), 1784);
+    CHECK_EQ(pwmNextEdge(9, 1784), 2040 + 256);
+    CHECK_EQ(pwmNextEdge(9, 2039), 2040 + 256);
+
+    // The other output of the timer shares its period boundaries
+    analogWrite(10, 200);
+    CHECK_EQ(pwmHighMicros(10), 1600);
+    CHECK_EQ(pwmNextEdge(10, 0), 800);
+    CHECK_EQ(pwmNextEdge(10, 800), 1240);
+
+    // The pin follows the waveform as time moves
+    CHECK_EQ(readAt(9, 100), HIGH);
+    CHECK_EQ(readAt(9, 300), LOW);
+    CHECK_EQ(readAt(9, 1800), HIGH);
+    CHECK_EQ(readAt(10, 1800), HIGH);
+    CHECK_EQ(readAt(9, 2040 + 257), LOW);
+    CHECK_EQ(readAt(10, 2040 + 900), LOW);
+
+    // A new value applies at once
+    uint64_t now = clockMicros64();
+    analogWrite(9, 255 / 2);
+    CHECK_EQ(pwmValue(9), 127);
+    CHECK_EQ(pwmHighMicros(9), 1016);
+    CHECK_EQ(digitalRead(9), pwmLevelAt(9, now));
+}
+
+static void testFast(void) {
+    // Timer0, 1024 us period, high for value + 1 ticks from its start
+    analogWrite(5, 127);
+    CHECK_EQ(pwmPeriodMicros(5), 1024);
+    CHECK_EQ(pwmHighMicros(5), 512);
+    CHECK(fabs(pwmFrequency(5) - 976.5625f) < 0.01f);
+    CHECK_EQ(pwmLevelAt(5, 0), HIGH);
+    CHECK_EQ(pwmLevelAt(5, 511), HIGH);
+    CHECK_EQ(pwmLevelAt(5, 512), LOW);
+    CHECK_EQ(pwmNextEdge(5, 0), 512);
+    CHECK_EQ(pwmNextEdge(5, 512), 1024);
+    CHECK_EQ(pwmNextEdge(5, 1023), 1024);
+
+    // Even value 1 is high for two ticks
+    analogWrite(6, 1);
+    CHECK_EQ(pwmHighMicros(6), 8);
+
+    uint64_t start = clockMicros64() - clockMicros64() % 1024 + 1024;
+    CHECK_EQ(readAt(6, start + 7), HIGH);
+    CHECK_EQ(readAt(6, start + 8), LOW);
+    CHECK_EQ(readAt(5, start + 10), HIGH);
+    CHECK_EQ(readAt(5, start + 600), LOW);
+}
+
+static void testStop(void) {
+    // 0 and 255 are constant levels, as are pins without a timer output
+    analogWrite(9, 0);
+    CHECK(!pwmRunning(9));
+    CHECK_EQ(digitalRead(9), LOW);
+    CHECK_EQ(pwmAverage(9), 0.0f);
+    CHECK_EQ(pwmPeriodMicros(9), 0);
+    CHECK_EQ(pwmNextEdge(9, 0), UINT64_MAX);
+    analogWrite(10, 255);
+    CHECK(!pwmRunning(10));
+    CHECK_EQ(digitalRead(10), HIGH);
+    CHECK_EQ(pwmAverage(10), 1.0f);
+    CHECK_EQ(pwmLevelAt(10, 12345), HIGH);
+    analogWrite(13, 100);
+    CHECK(!pwmRunning(13));
+    CHECK_EQ(digitalRead(13), LOW);
+    analogWrite(13, 200);
+    CHECK_EQ(digitalRead(13), HIGH);
+
+    // Every digital write ends PWM on the pins it touches
+    analogWrite(9, 100);
+    digitalWrite(9, HIGH);
+    CHECK(!pwmRunning(9));
+    CHECK_EQ(digitalRead(9), HIGH);
+
+    analogWrite(11, 100);
+    digitalWriteFast<11>(LOW);
+    CHECK(!pwmRunning(11));
+    analogWrite(11, 100);
+    digitalWriteFast(11, HIGH);
+    CHECK(!pwmRunning(11));
+    CHECK_EQ(digitalRead(11), HIGH);
+
+    analogWrite(9, 100);
+    analogWrite(10, 100);
+    digitalWritePort(PB, 0x02, 0x00);
+    CHECK(!pwmRunning(9));
+    CHECK(pwmRunning(10));
+
+    static const uint8_t groupPins[] = { 10, 3 };
+    PinGroup group;
+    pinGroupInit(&group, groupPins, 2);
+    analogWrite(3, 100);
+    pinGroupWrite(&group, 0x3);
+    CHECK(!pwmRunning(10));
+    CHECK(!pwmRunning(3));
+    CHECK_EQ(digitalRead(3), HIGH);
+
+    // Stopped outputs leave no edge events behind
+    analogWrite(5, 0);
+    analogWrite(6, 0);
+    schedulerSleepUntil(clockMicros64() + 10000);
+    CHECK_EQ(instance.scheduler.count, 0);
+    CHECK_EQ(digitalRead(9), LOW);
+    CHECK_EQ(digitalRead(10), HIGH);
+}
+
+void setup() {
+    simContextInit(&instance, 1);
+    SimContext *previous = simSetContext(&instance);
+    testPhaseCorrect();
+    testFast();
+    testStop();
+    simSetContext(previous);
+    simContextFree(&instance);
+    checkDone();
+}
+
+void loop() {
+}
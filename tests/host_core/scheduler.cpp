@@ -0,0 +1,150 @@
+/*
+  scheduler.cpp - Run budgets and event ordering of the scheduler
+
+  Each budget runs in a fresh instance so the limits set here do not leak
+  into the default one.
+*/
+
+#include "check.h"
+
+static SimContext instance;
+static uint32_t loops;
+static uint64_t loopTimes[4];
+
+static void countSetup(void) {
+}
+
+static void countLoop(void) {
+    if (loops < 4) {
+        loopTimes[loops] = micros();
+    }
+    loops++;
+}
+
+// Runs countLoop() in a fresh instance with the given budgets
+static SimContext *runBudget(uint64_t loop_limit, uint64_t time_limit_us, uint32_t period_us) {
+    simContextInit(&instance, 1);
+    instance.setup = countSetup;
+    instance.loop = countLoop;
+    SimContext *previous = simSetContext(&instance);
+    schedulerSetLoopLimit(loop_limit);
+    schedulerSetTimeLimit(time_limit_us);
+    schedulerSetLoopPeriod(period_us);
+    loops = 0;
+    simContextBegin();
+    while (schedulerStep(SIZE_MAX)) {
+    }
+    return previous;
+}
+
+static char order[8];
+static size_t orderCount;
+static uint64_t eventTimes[8];
+
+static void record(void *arg) {
+    eventTimes[orderCount] = clockMicros64();
+    order[orderCount++] = (char)(uintptr_t)arg;
+}
+
+static void stopRun(void *arg) {
+    (void)arg;
+    schedulerStop();
+}
+
+static void testLoopBudget(void) {
+    SimContext *previous = runBudget(25, 0, 10);
+    CHECK_EQ(loops, 25);
+    CHECK_EQ(instance.scheduler.loops, 25);
+    // The first iteration runs at time 0, then one every loop period
+    CHECK_EQ(loopTimes[0], 0);
+    CHECK_EQ(loopTimes[1], 10);
+    CHECK_EQ(loopTimes[3], 30);
+    CHECK(schedulerStopped());
+    simSetContext(previous);
+    simContextFree(&instance);
+}
+
+static void testTimeBudget(void) {
+    // Iterations at 0, 10, ..., 1000 are inside the budget; the clock
+    // ends on the limit, not on the next iteration's time
+    SimContext *previous = runBudget(0, 1000, 10);
+    CHECK_EQ(loops, 101);
+    CHECK_EQ(clockMicros64(), 1000);
+    CHECK(schedulerStopped());
+    simSetContext(previous);
+    simContextFree(&instance);
+}
+
+static void testDelayBudget(void) {
+    simContextInit(&instance, 2);
+    SimContext *previous = simSetContext(&instance);
+    schedulerSetTimeLimit(1500);
+    // A delay crossing the budget ends on it and stops the run
+    delay(1);
+    CHECK_EQ(micros(), 1000);
+    CHECK(!schedulerStopped());
+    delay(5000);
+    CHECK_EQ(micros(), 1500);
+    CHECK(schedulerStopped());
+    simSetContext(previous);
+    simContextFree(&instance);
+}
+
+static void testEventOrder(void) {
+    simContextInit(&instance, 3);
+    SimContext *previous = simSetContext(&instance);
+    // Events run by time; ties in the order they were posted
+    schedulerPost(30, SIM_EVENT_TIMER, record, (void *)'d');
+    schedulerPost(10, SIM_EVENT_TIMER, record, (void *)'a');
+    schedulerPost(20, SIM_EVENT_TIMER, record, (void *)'c');
+    schedulerPost(10, SIM_EVENT_TIMER, record, (void *)'b');
+    schedulerPost(500, SIM_EVENT_TIMER, record, (void *)'e');
+    orderCount = 0;
+    delayMicroseconds(100);
+    CHECK_EQ(orderCount, 4);
+    order[orderCount] = '\0';
+    CHECK_STR(order, "abcd");
+    // Each at its own instant, while the sketch sleeps
+    CHECK_EQ(eventTimes[0], 10);
+    CHECK_EQ(eventTimes[2], 20);
+    CHECK_EQ(eventTimes[3], 30);
+    CHECK_EQ(micros(), 100);
+    delayMicroseconds(1000);
+    CHECK_EQ(orderCount, 5);
+    CHECK_EQ(eventTimes[4], 500);
+    CHECK_EQ(micros(), 1100);
+    simSetContext(previous);
+    simContextFree(&instance);
+}
+
+static void testStop(void) {
+    simContextInit(&instance, 4);
+    instance.setup = countSetup;
+    instance.loop = countLoop;
+    SimContext *previous = simSetContext(&instance);
+    schedulerSetLoopLimit(0);
+    schedulerSetTimeLimit(0);
+    schedulerSetLoopPeriod(100);
+    loops = 0;
+    schedulerPost(250, SIM_EVENT_TIMER, stopRun, NULL);
+    simContextBegin();
+    while (schedulerStep(SIZE_MAX)) {
+    }
+    // Iterations at 0, 100 and 200, then the stop event at 250
+    CHECK_EQ(loops, 3);
+    CHECK_EQ(micros(), 250);
+    simSetContext(previous);
+    simContextFree(&instance);
+}
+
+void setup() {
+    testLoopBudget();
+    testTimeBudget();
+    testDelayBudget();
+    testEventOrder();
+    testStop();
+    checkDone();
+}
+
+void loop() {
+}
@@ -0,0 +1,170 @@
+/*
+  serial.cpp - Ring wrap-around and number formatting of Serial
+
+  Mostly runs in a second instance, whose Serial goes through the
+  in-process channel, so the driver reads back exactly what the sketch
+  wrote. The default instance checks when a polled backend sees output.
+*/
+
+// Standard library headers must come before Arduino.h and its macros
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "check.h"
+#include "SerialBackend.h"
+
+static SimContext instance;
+static char received[64];
+
+// Everything queued on TX so far, as a string
+static const char *output(void) {
+    size_t size = serialChannelRead(&instance, (uint8_t *)received, sizeof(received) - 1);
+    received[size] = '\0';
+    return received;
+}
+
+static void testWrap(void) {
+    CHECK_EQ(Serial.availableForWrite(), 16);
+    CHECK_EQ(Serial.write("0123456789"), 10);
+    CHECK_STR(output(), "0123456789");
+    // Crosses the end of the ring and comes back out in order
+    CHECK_EQ(Serial.write("abcdefghijkl"), 12);
+    CHECK_EQ(Serial.availableForWrite(), 4);
+    CHECK_STR(output(), "abcdefghijkl");
+    CHECK_EQ(Serial.availableForWrite(), 16);
+    // Scatter-gather writes wrap the same way
+    SerialSpan spans[2] = { { (const uint8_t *)"ABCDEFG", 7 }, { (const uint8_t *)"HIJKLMN", 7 } };
+    CHECK_EQ(Serial.write(spans, 2), 14);
+    CHECK_STR(output(), "ABCDEFGHIJKLMN");
+
+    // RX wraps too
+    for (int round = 0; round < 3; round++) {
+        CHECK_EQ(serialChannelWrite(&instance, (const uint8_t *)"uvwxyz", 6), 6);
+        CHECK_EQ(Serial.available(), 6);
+        CHECK_EQ(Serial.peek(), 'u');
+        CHECK_EQ(Serial.read(), 'u');
+        char rest[6] = { 0 };
+        for (int i = 0; i < 5; i++) {
+            rest[i] = (char)Serial.read();
+        }
+        CHECK_STR(rest, "vwxyz");
+        CHECK_EQ(Serial.read(), -1);
+    }
+    // A full RX ring takes no more
+    uint8_t fill[20];
+    memset(fill, 'r', sizeof(fill));
+    CHECK_EQ(serialChannelWrite(&instance, fill, sizeof(fill)), 16);
+    CHECK_EQ(Serial.available(), 16);
+    while (Serial.read() >= 0) {
+    }
+}
+
+#define CHECK_PRINT(call, expected) \
+    do { \
+        size_t written = (call); \
+        CHECK_STR(output(), expected); \
+        CHECK_EQ(written, strlen(expected)); \
+    } while (0)
+
+static void testNumbers(void) {
+    CHECK_PRINT(Serial.print(0), "0");
+    CHECK_PRINT(Serial.print(-123), "-123");
+    CHECK_PRINT(Serial.print(2147483647L), "2147483647");
+    CHECK_PRINT(Serial.print((long)-2147483647L - 1), "-2147483648");
+    CHECK_PRINT(Serial.print(4294967295UL), "4294967295");
+    CHECK_PRINT(Serial.print(255, HEX), "FF");
+    CHECK_PRINT(Serial.print(8, OCT), "10");
+    CHECK_PRINT(Serial.print(5, BIN), "101");
+    // Only DEC prints a sign; other bases show the two's complement
+    CHECK_PRINT(Serial.print(-1, HEX), sizeof(long) == 8 ? "FFFFFFFFFFFFFFFF" : "FFFFFFFF");
+    CHECK_PRINT(Serial.print(65, 0), "A");
+    CHECK_PRINT(Serial.print('x'), "x");
+    CHECK_PRINT(Serial.println(42), "42\r\n");
+    CHECK_PRINT(Serial.println(), "\r\n");
+
+    CHECK_PRINT(Serial.print(3.14159), "3.14");
+    CHECK_PRINT(Serial.print(3.14159, 3), "3.142");
+    CHECK_PRINT(Serial.print(-0.5), "-0.50");
+    CHECK_PRINT(Serial.print(2.0, 0), "2");
+    CHECK_PRINT(Serial.print(0.999, 2), "1.00");
+    CHECK_PRINT(Serial.print(1.0 / 0.0), "inf");
+    CHECK_PRINT(Serial.print(0.0 / 0.0), "nan");
+    CHECK_PRINT(Serial.print(5e9), "ovf");
+
+    CHECK_PRINT(Serial.print(String("str")), "str");
+    CHECK_PRINT(Serial.print(F("flash")), "flash");
+    CHECK_PRINT(Serial.println(String("con") + "cat" + 1), "concat1\r\n");
+
+    // A number too long for the space left wraps like any other write
+    CHECK_EQ(Serial.write("0123456789AB"), 12);
+    CHECK_STR(output(), "0123456789AB");
+    CHECK_PRINT(Serial.print(-1234567890L), "-1234567890");
+}
+
+static void testStall(void) {
+    // With nobody reading, a full TX ring is given up on after
+    // SERIAL_CHANNEL_STALL_US and the rest of the output dropped
+    uint8_t block[40];
+    memset(block, 's', sizeof(block));
+    CHECK(Serial.write(block, sizeof(block)) < sizeof(block));
+    CHECK_EQ(Serial.write('s'), 0);
+    // Reading resumes output
+    output();
+    CHECK_EQ(Serial.write('t'), 1);
+    CHECK_STR(output(), "t");
+}
+
+// Whatever the pipe backend has written so far
+static const char *piped(int fd) {
+    ssize_t size = read(fd, received, sizeof(received) - 1);
+    received[size > 0 ? size : 0] = '\0';
+    return received;
+}
+
+static void printFromEvent(void *arg) {
+    Serial.print((const char *)arg);
+}
+
+static void testDrain(void) {
+    // Polled backends get TX bytes whenever virtual time moves, not only
+    // after loop() returns
+    int fds[2];
+    CHECK(pipe(fds) == 0);
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    Serial.begin(9600);
+    serialSetBackend(new FdSerialBackend(-1, fds[1], true, "pipe"));
+
+    Serial.print("hello");
+    CHECK_STR(piped(fds[0]), "");
+    delay(1);
+    CHECK_STR(piped(fds[0]), "hello");
+    Serial.println(42);
+    delayMicroseconds(1);
+    CHECK_STR(piped(fds[0]), "42\r\n");
+
+    // Output of an event that fires during a delay() leaves at its instant
+    schedulerPost(clockMicros64() + 10, SIM_EVENT_TIMER, printFromEvent, (void *)"event");
+    delay(1);
+    CHECK_STR(piped(fds[0]), "event");
+
+    Serial.end();
+    serialSetBackend(NULL);
+    close(fds[0]);
+}
+
+void setup() {
+    testDrain();
+    simContextInit(&instance, 1);
+    SimContext *previous = simSetContext(&instance);
+    Serial.setBufferSizes(16, 16);
+    Serial.begin(9600);
+    testWrap();
+    testNumbers();
+    testStall();
+    simSetContext(previous);
+    simContextFree(&instance);
+    checkDone();
+}
+
+void loop() {
+}
@@ -0,0 +1,170 @@
+/*
+  string.cpp - String storage, growth and concatenation
+*/
+
+#include "check.h"
+
+// malloc() with statistics, to count what a String asks for
+class CountingAllocator : public StringAllocator {
+public:
+    void *allocate(size_t size) override {
+        noteAllocate(size);
+        return malloc(size);
+    }
+    void release(void *ptr, size_t size) override {
+        noteRelease(size);
+        free(ptr);
+    }
+};
+
+static const char text40[] = "0123456789012345678901234567890123456789";
+
+static void testInline(void) {
+    CountingAllocator counting;
+    String empty(&counting);
+    CHECK_EQ(empty.length(), 0);
+    CHECK_STR(empty.c_str(), "");
+
+    // Up to STRING_SSO_CAPACITY characters stay in the object
+    String small(&counting);
+    for (int i = 0; i < STRING_SSO_CAPACITY; i++) {
+        small += 'a';
+    }
+    CHECK_EQ(small.length(), STRING_SSO_CAPACITY);
+    CHECK_EQ(counting.allocations(), 0);
+    small += 'b';
+    CHECK_EQ(counting.allocations(), 1);
+    CHECK(small.capacity() > STRING_SSO_CAPACITY);
+    CHECK(small.endsWith("ab"));
+}
+
+static void testGrowth(void) {
+    CountingAllocator counting;
+    String s(&counting);
+    for (int i = 0; i < 1000; i++) {
+        s += (char)('a' + i % 26);
+    }
+    CHECK_EQ(s.length(), 1000);
+    CHECK_EQ(s[999], 'a' + 999 % 26);
+    // Geometric growth: a logarithmic number of buffers
+    CHECK(counting.allocations() <= 16);
+    CHECK_EQ(counting.used(), s.capacity() + 1);
+
+    // reserve() sizes the buffer once
+    String reserved(&counting);
+    uint32_t before = counting.allocations();
+    CHECK(reserved.reserve(500));
+    for (int i = 0; i < 500; i++) {
+        reserved += 'x';
+    }
+    CHECK_EQ(counting.allocations() - before, 1);
+
+    // Moving steals the buffer
+    const char *buffer = s.c_str();
+    String moved(std::move(s));
+    CHECK(moved.c_str() == buffer);
+    CHECK_EQ(moved.length(), 1000);
+    CHECK_EQ(s.length(), 0);
+}
+
+static void testConcat(void) {
+    CountingAllocator counting;
+    stringSetAllocator(&counting);
+    String head("head-");
+    String tail("-tail");
+    uint32_t before = counting.allocations();
+    // One allocation, at the final length, for the whole expression
+    String joined = head + "C-string-" + 12 + 'x' + -3L + F("-flash") + 2.5 + tail;
+    CHECK_STR(joined.c_str(), "head-C-string-12x-3-flash2.50-tail");
+    CHECK_EQ(counting.allocations() - before, 1);
+    CHECK_EQ(joined.capacity(), joined.length());
+    stringSetAllocator(NULL);
+
+    // Numbers append their digits, 0 included
+    String numbers;
+    numbers += 0;
+    numbers += 7u;
+    numbers += -1L;
+    numbers.concat(255);
+    numbers += 1.5f;
+    CHECK_STR(numbers.c_str(), "07-12551.50");
+    String chars;
+    chars += 'c';
+    chars.concat((unsigned char)9);
+    CHECK_STR(chars.c_str(), "c9");
+
+    // Appending a string to itself, inline and on the heap
+    String self("abc");
+    self += self;
+    CHECK_STR(self.c_str(), "abcabc");
+    String longSelf(text40);
+    longSelf += longSelf;
+    CHECK_EQ(longSelf.length(), 80);
+    CHECK(longSelf.startsWith(text40));
+    CHECK(longSelf.endsWith(text40));
+
+    // A null C string appends nothing
+    String none("x");
+    none += (const char *)NULL;
+    CHECK_STR(none.c_str(), "x");
+
+    CHECK(String("abc") == "abc");
+    CHECK(String(String(text40) + "!") == String(String(text40) + '!'));
+}
+
+// Generic code written against String, as libraries take it
+template <typename Text>
+static const char *textOf(const Text &text) {
+    return text.c_str();
+}
+
+static void testConcatAsString(void) {
+    CountingAllocator counting;
+    stringSetAllocator(&counting);
+    String a("abc");
+    String b("defghijklmnopqrstuvwxyz");
+    uint32_t before = counting.allocations();
+
+    // Member access builds the text once, whatever is called on it
+    CHECK_STR((a + b).c_str(), "abcdefghijklmnopqrstuvwxyz");
+    CHECK_EQ(counting.allocations() - before, 1);
+    CHECK((a + b) == "abcdefghijklmnopqrstuvwxyz");
+    CHECK((a + b) == String(a + b));
+    CHECK((a + "x") != "abc");
+    CHECK((a + "x") != a);
+    CHECK((a + "a") < (a + "b"));
+    CHECK((a + 1) >= String("abc1"));
+    CHECK_EQ((a + b).indexOf('d'), 3);
+    CHECK_EQ((a + "-" + b).indexOf("de"), 4);
+    CHECK_EQ((a + b + a).lastIndexOf("abc"), 26);
+    CHECK_EQ((a + b).charAt(2), 'c');
+    CHECK_EQ((a + b)[3], 'd');
+    CHECK((a + b).startsWith("abcd"));
+    CHECK((a + b).endsWith("xyz"));
+    CHECK((a + b).equalsIgnoreCase("ABCDEFGHIJKLMNOPQRSTUVWXYZ"));
+    CHECK_STR((a + b).substring(2, 5).c_str(), "cde");
+    CHECK_EQ((String("12") + 34).toInt(), 1234);
+    CHECK_STR(textOf(a + '/' + 7), "abc/7");
+    char buf[8];
+    (a + b).toCharArray(buf, sizeof(buf));
+    CHECK_STR(buf, "abcdefg");
+    CHECK((a + b) ? true : false);
+
+    // Converting still formats straight into one buffer
+    before = counting.allocations();
+    String joined = a + b + "-" + 42;
+    CHECK_EQ(counting.allocations() - before, 1);
+    CHECK_STR(joined.c_str(), "abcdefghijklmnopqrstuvwxyz-42");
+    stringSetAllocator(NULL);
+}
+
+void setup() {
+    testInline();
+    testGrowth();
+    testConcat();
+    testConcatAsString();
+    checkDone();
+}
+
+void loop() {
+}
@@ -0,0 +1,53 @@
+"""Behaviour tests for the host-simulated Arduino core.
+
+Each driver in tests/host_core is a sketch whose setup() runs its checks
+(see check.h) and exits non-zero if any failed. The core is compiled once
+per session with the host C++ compiler and linked into every driver.
+"""
+
+import os
+import shutil
+import subprocess
+from pathlib import Path
+
+import pytest
+
+ROOT = Path(__file__).resolve().parents[1]
+CORE_DIR = ROOT / "arduino_ide" / "cores" / "arduino"
+DRIVER_DIR = Path(__file__).resolve().parent / "host_core"
+CXX = os.environ.get("CXX", "g++")
+CXXFLAGS = ["-std=gnu++11", "-O1", "-Wall", f"-I{CORE_DIR}", f"-I{DRIVER_DIR}"]
+DRIVERS = sorted(path.stem for path in DRIVER_DIR.glob("*.cpp"))
+
+pytestmark = pytest.mark.skipif(shutil.which(CXX) is None, reason=f"{CXX} not available")
+
+
+def compile_or_fail(args):
+    result = subprocess.run([CXX, *args], capture_output=True, text=True)
+    if result.returncode != 0:
+        pytest.fail(result.stderr)
+
+
+@pytest.fixture(scope="session")
+def core_objects(tmp_path_factory):
+    build_dir = tmp_path_factory.mktemp("core")
+    objects = []
+    for source in sorted(CORE_DIR.glob("*.cpp")):
+        obj = build_dir / f"{source.stem}.o"
+        compile_or_fail([*CXXFLAGS, "-c", str(source), "-o", str(obj)])
+        objects.append(str(obj))
+    return objects
+
+
+@pytest.mark.parametrize("driver", DRIVERS)
+def test_host_core(driver, core_objects, tmp_path):
+    exe = tmp_path / driver
+    compile_or_fail([*CXXFLAGS, str(DRIVER_DIR / f"{driver}.cpp"), *core_objects, "-o", str(exe), "-lpthread"])
+
+    # A virtual clock makes every driver deterministic; drivers write their
+    # scratch files to the working directory
+    env = {k: v for k, v in os.environ.items() if not k.startswith("ARDUINO_")}
+    env.update(ARDUINO_CLOCK="virtual", ARDUINO_SIM_LOOP_LIMIT="1")
+    result = subprocess.run([str(exe)], cwd=tmp_path, env=env, capture_output=True, text=True, timeout=60)
+
+    assert result.returncode == 0, result.stdout + result.stderr
@@ -0,0 +1,151 @@
+"""Tests for the parser of ports announced by host-simulated sketches."""
+
+import os
+import shutil
+import subprocess
+import sys
+from pathlib import Path
+
+import pytest
+
+sys.path.insert(0, str(Path(__file__).resolve().parents[1]))
+
+from arduino_ide.services.simulated_ports import (
+    SimulatedPortScanner,
+    find_simulated_ports,
+    parse_simulated_port,
+    run_announcing_ports,
+)
+
+CORE_DIR = Path(__file__).resolve().parents[1] / "arduino_ide" / "cores" / "arduino"
+CXX = os.environ.get("CXX", "g++")
+
+# Opens its Serial (a pty under ARDUINO_SERIAL=pty) and keeps it open for a
+# moment of real time
+SKETCH = """
+#include <Arduino.h>
+
+void setup() {
+    Serial.begin(9600);
+    Serial.println("hello");
+    delay(300);
+}
+
+void loop() {
+}
+"""
+
+
+def test_parses_announcement():
+    assert parse_simulated_port("Serial: pty /dev/pts/3\n") == "/dev/pts/3"
+    assert parse_simulated_port("  Serial: pty /tmp/board0 ") == "/tmp/board0"
+
+
+def test_ignores_other_lines():
+    assert parse_simulated_port("Serial: cannot open ARDUINO_SERIAL=pty, using stdio") is None
+    assert parse_simulated_port("warning: Serial: pty /dev/pts/3") is None
+    assert parse_simulated_port("") is None
+
+
+def test_finds_every_port_in_a_chunk():
+    text = "compiling...\nSerial: pty /dev/pts/4\nboard 1\r\nSerial: pty /dev/pts/5\r\n"
+    assert find_simulated_ports(text) == ["/dev/pts/4", "/dev/pts/5"]
+
+
+def test_scanner_joins_lines_split_across_chunks():
+    ports = []
+    scanner = SimulatedPortScanner(ports.append)
+    scanner.feed("Serial: pt")
+    assert ports == []
+    scanner.feed("y /dev/pts/6\nSerial: pty /dev/pts/7")
+    assert ports == ["/dev/pts/6"]
+    scanner.finish()
+    assert ports == ["/dev/pts/6", "/dev/pts/7"]
+
+    # A new process starts with a clean line
+    scanner.feed("Serial: pty /dev/pts/8")
+    scanner.reset()
+    scanner.feed("\n")
+    assert ports == ["/dev/pts/6", "/dev/pts/7"]
+
+
+def test_run_announcing_ports_captures_like_subprocess_run():
+    script = "import sys; print('out'); print('Serial: pty /tmp/sim0', file=sys.stderr)"
+    ports = []
+    result = run_announcing_ports([sys.executable, "-c", script], ports.append, timeout=30)
+    assert result.returncode == 0
+    assert result.stdout == "out\n"
+    assert result.stderr == "Serial: pty /tmp/sim0\n"
+    assert ports == ["/tmp/sim0"]
+
+    with pytest.raises(subprocess.TimeoutExpired):
+        run_announcing_ports([sys.executable, "-c", "import time; time.sleep(30)"], ports.append, timeout=0.5)
+
+
+@pytest.fixture(scope="module")
+def pty_sketch(tmp_path_factory):
+    if shutil.which(CXX) is None:
+        pytest.skip(f"{CXX} not available")
+    build_dir = tmp_path_factory.mktemp("pty_sketch")
+    source = build_dir / "sketch.cpp"
+    source.write_text(SKETCH)
+    exe = build_dir / "sketch"
+    result = subprocess.run(
+        [CXX, "-std=gnu++11", "-O1", f"-I{CORE_DIR}", str(source),
+         *map(str, sorted(CORE_DIR.glob("*.cpp"))), "-o", str(exe), "-lpthread"],
+        capture_output=True, text=True)
+    if result.returncode != 0:
+        pytest.fail(result.stderr)
+    return exe
+
+
+def run_pty_sketch(exe, on_port):
+    env = {k: v for k, v in os.environ.items() if not k.startswith("ARDUINO_")}
+    env.update(ARDUINO_SERIAL="pty", ARDUINO_SIM_LOOP_LIMIT="1")
+    return run_announcing_ports([str(exe)], on_port, cwd=str(exe.parent), env=env, timeout=30)
+
+
+class RecordingMonitor:
+    """Stands in for SerialMonitor where Qt is unavailable."""
+
+    def __init__(self):
+        self.simulated_ports = {}
+
+    def add_simulated_port(self, device, description="Simulated board"):
+        # SerialMonitor drops devices that no longer exist
+        if os.path.exists(device):
+            self.simulated_ports[device] = description
+
+
+def test_sketch_stderr_offers_a_port(pty_sketch):
+    monitor = RecordingMonitor()
+    result = run_pty_sketch(pty_sketch, monitor.add_simulated_port)
+    if "Serial: pty" not in result.stderr:
+        pytest.skip(f"no pseudo-terminals here: {result.stderr}")
+    assert result.returncode == 0, result.stderr
+    assert list(monitor.simulated_ports) == find_simulated_ports(result.stderr)
+    assert len(monitor.simulated_ports) == 1
+
+
+def test_sketch_stderr_adds_a_serial_monitor_entry(pty_sketch):
+    pytest.importorskip("serial")
+    widgets = pytest.importorskip("PySide6.QtWidgets")
+    os.environ.setdefault("QT_QPA_PLATFORM", "offscreen")
+    app = widgets.QApplication.instance() or widgets.QApplication([])
+    from arduino_ide.ui.serial_monitor import SerialMonitor
+
+    monitor = SerialMonitor()
+    entries = []
+
+    def offer(device):
+        monitor.add_simulated_port(device)
+        entries.append((device, monitor.port_combo.findData(device)))
+
+    result = run_pty_sketch(pty_sketch, offer)
+    if "Serial: pty" not in result.stderr:
+        pytest.skip(f"no pseudo-terminals here: {result.stderr}")
+    assert len(entries) == 1
+    device, index = entries[0]
+    assert index >= 0
+    assert monitor.port_combo.itemText(index) == f"{device} - Simulated board"
+    app.processEvents()
@@ -0,0 +1,56 @@
+"""Tests for the binary telemetry frame decoder."""
+
+import binascii
+import struct
+import sys
+from pathlib import Path
+
+sys.path.insert(0, str(Path(__file__).resolve().parents[1]))
+
+from arduino_ide.services.telemetry_decoder import (
+    TELEMETRY_FLOAT32,
+    TELEMETRY_INT16,
+    TelemetryDecoder,
+)
+
+
+def make_frame(sample_type, fmt, values, sequence=0):
+    """Build a frame the way Telemetry.cpp does."""
+    payload = struct.pack(f"<{len(values)}{fmt}", *values)
+    body = struct.pack("<HBBB", len(payload), sample_type, len(values), sequence) + payload
+    return b"\xa5\x5a" + body + struct.pack("<H", binascii.crc_hqx(body, 0xFFFF))
+
+
+def test_decodes_frames_split_across_reads():
+    stream = make_frame(TELEMETRY_INT16, "h", [1, -2, 300], 0) + make_frame(TELEMETRY_FLOAT32, "f", [0.5, -1.25], 1)
+    decoder = TelemetryDecoder()
+
+    frames = []
+    for i in range(0, len(stream), 3):
+        frames += decoder.feed(stream[i:i + 3])
+
+    assert [f.values for f in frames] == [(1, -2, 300), (0.5, -1.25)]
+    assert [f.sample_type for f in frames] == [TELEMETRY_INT16, TELEMETRY_FLOAT32]
+    assert decoder.frames_lost == 0
+
+
+def test_skips_text_and_corrupt_frames():
+    good = make_frame(TELEMETRY_INT16, "h", [7], 5)
+    corrupt = bytearray(make_frame(TELEMETRY_INT16, "h", [8], 6))
+    corrupt[-3] ^= 0xFF
+    decoder = TelemetryDecoder()
+
+    frames = decoder.feed(b"boot ok\r\n" + bytes(corrupt) + good)
+
+    assert [f.values for f in frames] == [(7,)]
+    assert decoder.crc_errors == 1
+    assert decoder.bytes_skipped >= len(b"boot ok\r\n")
+
+
+def test_counts_lost_frames_across_sequence_wrap():
+    decoder = TelemetryDecoder()
+    decoder.feed(make_frame(TELEMETRY_INT16, "h", [1], 254))
+    decoder.feed(make_frame(TELEMETRY_INT16, "h", [2], 1))
+
+    assert decoder.frames_decoded == 2
+    assert decoder.frames_lost == 2